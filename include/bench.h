@@ -0,0 +1,70 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include "camera.h"
+#include "gputimer.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#define BENCH_MAX_KEYS 64
+
+// One camera keyframe, the path is a Catmull-Rom spline through them
+typedef struct {
+    float time;                 // seconds from the first measured frame
+    vec3 position;
+    float yaw, pitch;
+} BenchKey;
+
+// GPU times of one named zone (frame graph pass) over the measured frames
+typedef struct {
+    const char* name;           // owned by the GPU timer
+    float* ms;
+    int count;
+} BenchZone;
+
+typedef struct {
+    BenchKey keys[BENCH_MAX_KEYS];
+    int keyCount;
+    int warmupFrames;           // rendered at the first key, not measured
+    int measuredFrames;
+    float dt;                   // fixed simulation step, seconds
+
+    // per measured frame, milliseconds
+    float* cpuMs;
+    float* frameMs;
+
+    // GPU times arrive GPU_TIMER_FRAMES late and may drop, "frame" is one of them
+    BenchZone zones[GPU_TIMER_MAX_NAMES];
+    int zoneCount;
+    int zoneHeads[GPU_TIMER_MAX_NAMES]; // last seen head of each GPU timer history
+
+    int64_t drawCalls, triangles, stateChanges;   // summed over measured frames
+    int64_t maxDrawCalls, maxTriangles;
+    int64_t peakTextureBytes, peakBufferBytes;
+} Bench;
+
+// Parse a script:
+//   warmup <frames>
+//   frames <frames>       (default: the length of the path)
+//   dt <seconds>          (default 1/60)
+//   key <time> <x> <y> <z> <yaw> <pitch>
+// '#' starts a comment
+bool bench_load(Bench* bench, const char* path);
+
+// Warm-up, measured frames and the few it takes for GPU timings to arrive
+int bench_total_frames(const Bench* bench);
+
+// Pose the camera for frame `frame` of the run
+void bench_camera(const Bench* bench, int frame, Camera* camera);
+
+// Collect the stats of a finished frame, after stats_end_frame
+void bench_record(Bench* bench, int frame, float frameMs, float cpuMs);
+
+// JSON with frame time percentiles and every sample, render counters and
+// peak memory. scene names what was drawn, for tools/benchcmp
+bool bench_write_report(const Bench* bench, const char* scriptPath, const char* scene,
+                        const char* reportPath, int width, int height);
+
+void bench_destroy(Bench* bench);
+
+#endif
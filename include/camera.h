@@ -33,6 +33,9 @@ void camera_process_keyboard(Camera* cam, Camera_Movement direction, float delta
 
 void camera_process_mouse(Camera* cam, float xoffset, float yoffset, bool constrainPitch);
 
+// Place the camera directly, e.g. from a scripted path
+void camera_set_pose(Camera* cam, vec3 position, float yaw, float pitch);
+
 void camera_get_view_matrix(Camera* cam, mat4 view);
 
 #endif
@@ -0,0 +1,26 @@
+#ifndef FIXEDSTEP_H
+#define FIXEDSTEP_H
+
+#include <stdint.h>
+
+#define FIXEDSTEP_DEFAULT_HZ 120.0f
+#define FIXEDSTEP_DEFAULT_MAX_STEPS 8   // updates per frame before time is dropped
+
+typedef struct {
+    double step;            // seconds per update
+    int maxSteps;
+    double accumulator;     // frame time not simulated yet, less than a step after fixedstep_advance
+    uint64_t steps;         // updates run so far
+    double dropped;         // seconds given up to the catch-up cap
+} FixedStep;
+
+void fixedstep_init(FixedStep* sim, float hz, int maxSteps);
+
+// Add a frame's time, returns how many updates of sim->step to run now
+int fixedstep_advance(FixedStep* sim, double frameTime);
+
+// How far between the previous and the latest update the frame is, 0 to 1,
+// for blending the two states when drawing
+float fixedstep_alpha(const FixedStep* sim);
+
+#endif
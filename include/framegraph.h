@@ -0,0 +1,130 @@
+#ifndef FRAMEGRAPH_H
+#define FRAMEGRAPH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <glad/glad.h>
+
+#define FRAMEGRAPH_MAX_PASSES 32
+#define FRAMEGRAPH_MAX_RESOURCES 32
+#define FRAMEGRAPH_MAX_PASS_IO 8
+#define FRAMEGRAPH_MAX_COLOR_TARGETS 4
+#define FRAMEGRAPH_MAX_PHYSICAL 32
+#define FRAMEGRAPH_MAX_TARGETS 32
+
+// Pool entries not used for this many frames give their GL objects back
+#define FRAMEGRAPH_POOL_TTL 120
+
+typedef int FgResourceId;
+#define FG_NONE (-1)
+
+typedef void (*FramegraphExecuteFn)(void* user);
+
+typedef enum { FG_RESOURCE_TEXTURE, FG_RESOURCE_BUFFER } FgResourceType;
+
+typedef struct {
+    const char* name;
+    FgResourceType type;
+    bool imported;
+    GLuint importedFbo;     // imported render targets only
+    int width, height;
+    GLenum format;          // sized internal format of textures
+    GLsizeiptr size;        // bytes of buffers
+
+    int firstUse, lastUse;  // execution order indices, -1 when unused
+    int physical;           // pool slot backing a transient resource
+} FgResource;
+
+typedef struct {
+    const char* name;
+    FramegraphExecuteFn execute;
+    void* user;
+    FgResourceId reads[FRAMEGRAPH_MAX_PASS_IO];
+    int readCount;
+    FgResourceId writes[FRAMEGRAPH_MAX_PASS_IO];
+    int writeCount;
+    bool sideEffect;        // never culled
+
+    bool culled;
+    bool hasTarget;         // binds a framebuffer before executing
+    GLuint fbo;
+    int width, height;
+} FgPass;
+
+// A physical GL texture or buffer that transient resources are aliased onto
+typedef struct {
+    FgResourceType type;
+    int width, height;
+    GLenum format;
+    GLsizeiptr size;
+    GLuint id;
+    int busyUntil;          // last execution index of the current occupant
+    int lastFrame;
+} FgPhysical;
+
+// Cached framebuffer for one set of attachments
+typedef struct {
+    GLuint colors[FRAMEGRAPH_MAX_COLOR_TARGETS];
+    int colorCount;
+    GLuint depth;
+    GLuint fbo;
+    int lastFrame;
+} FgTarget;
+
+typedef struct {
+    FgPass passes[FRAMEGRAPH_MAX_PASSES];
+    int passCount;
+    FgResource resources[FRAMEGRAPH_MAX_RESOURCES];
+    int resourceCount;
+
+    int order[FRAMEGRAPH_MAX_PASSES];   // compiled execution order
+    int orderCount;
+
+    FgPhysical pool[FRAMEGRAPH_MAX_PHYSICAL];
+    int poolCount;
+    FgTarget targets[FRAMEGRAPH_MAX_TARGETS];
+    int targetCount;
+
+    int frame;
+    int fboSwitches;                    // framebuffer binds done by the last execute
+    size_t transientBytes;              // every transient resource on its own
+    size_t physicalBytes;               // what aliasing actually allocates
+} FrameGraph;
+
+void framegraph_init(FrameGraph* fg);
+
+// Start declaring this frame's passes, physical resources are kept between frames
+void framegraph_begin(FrameGraph* fg);
+
+// An externally owned framebuffer (e.g. the window), writing it keeps a pass alive
+FgResourceId framegraph_import_target(FrameGraph* fg, const char* name, GLuint fbo, int width, int height);
+
+// Transient resources, only allocated if a surviving pass uses them
+FgResourceId framegraph_create_texture(FrameGraph* fg, const char* name, int width, int height, GLenum format);
+FgResourceId framegraph_create_buffer(FrameGraph* fg, const char* name, GLsizeiptr size);
+
+int framegraph_add_pass(FrameGraph* fg, const char* name, FramegraphExecuteFn execute, void* user);
+
+void framegraph_read(FrameGraph* fg, int pass, FgResourceId res);
+
+// Writing a texture attaches it to the pass framebuffer, in declaration order
+void framegraph_write(FrameGraph* fg, int pass, FgResourceId res);
+
+void framegraph_side_effect(FrameGraph* fg, int pass);
+
+// Cull, order, alias and build framebuffers
+bool framegraph_compile(FrameGraph* fg);
+
+void framegraph_execute(FrameGraph* fg);
+
+// Physical GL objects behind a resource, valid while executing
+GLuint framegraph_texture(const FrameGraph* fg, FgResourceId res);
+GLuint framegraph_buffer(const FrameGraph* fg, FgResourceId res);
+
+// Print the compiled graph and its memory footprint
+void framegraph_dump(const FrameGraph* fg, FILE* out);
+
+void framegraph_destroy(FrameGraph* fg);
+
+#endif
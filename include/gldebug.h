@@ -0,0 +1,33 @@
+#ifndef GLDEBUG_H
+#define GLDEBUG_H
+
+#include <stdbool.h>
+#include <stdio.h>
+
+#define GLDEBUG_MAX_MESSAGES 256  // distinct messages counted, later ones only add to the totals
+#define GLDEBUG_MAX_LABELS 1024   // labelled objects remembered for reports
+#define GLDEBUG_MAX_DEPTH 16      // nested debug groups tracked
+
+// Install the debug callback on the current context. Needs a debug context
+// (window_hint_debug) and KHR_debug, false and no-op otherwise
+bool gldebug_init(void);
+
+bool gldebug_enabled(void);
+
+// Name a GL object (GL_BUFFER, GL_TEXTURE, GL_PROGRAM, GL_VERTEX_ARRAY, ...)
+// after the asset it holds. No-op unless enabled
+void gldebug_label(unsigned int type, unsigned int object, const char* label);
+
+// The label given to an object, NULL if none
+const char* gldebug_object_label(unsigned int type, unsigned int object);
+
+// Debug groups show up in captures and in every message reported inside them.
+// No-op unless enabled
+void gldebug_push_group(const char* name);
+
+void gldebug_pop_group(void);
+
+// Every distinct message with its category and count, most frequent first
+void gldebug_dump(FILE* out);
+
+#endif
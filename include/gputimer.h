@@ -0,0 +1,50 @@
+#ifndef GPUTIMER_H
+#define GPUTIMER_H
+
+#include <stdbool.h>
+#include <stdio.h>
+
+#define GPU_TIMER_FRAMES 4        // query ring depth, results are read 3 frames late
+#define GPU_TIMER_MAX_ZONES 32    // timed zones per frame
+#define GPU_TIMER_MAX_NAMES 32    // distinct zone names with statistics
+#define GPU_TIMER_HISTORY 120     // samples in the rolling window
+
+// Rolling statistics of one named zone, in milliseconds
+typedef struct {
+    const char* name;
+    float last;
+    float min, avg, p95, max;
+    int samples;                  // valid entries in history
+    float history[GPU_TIMER_HISTORY];
+    int head;
+} GpuTimerStats;
+
+bool gputimer_init(void);
+
+void gputimer_shutdown(void);
+
+// Read back the frame that left the ring (if the GPU is done with it) and
+// start timing this one, the whole frame is the zone "frame"
+void gputimer_begin_frame(void);
+
+void gputimer_end_frame(void);
+
+// Zones may nest and must end before gputimer_end_frame.
+// Returns -1 (and times nothing) when not initialized or full
+int gputimer_begin(const char* name);
+
+void gputimer_end(int zone);
+
+// Statistics by name, NULL until the first result of that zone arrives
+const GpuTimerStats* gputimer_stats(const char* name);
+
+int gputimer_stats_count(void);
+
+const GpuTimerStats* gputimer_stats_at(int index);
+
+// Frames whose results were dropped because the GPU was still busy with them
+int gputimer_dropped_frames(void);
+
+void gputimer_dump(FILE* out);
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef HUD_H
+#define HUD_H
+
+#include <stdbool.h>
+
+#define HUD_MAX_QUADS 4096 // glyphs, bars and panels per frame
+
+// Font atlas, stream buffer and shader. The overlay starts hidden
+bool hud_init(void);
+
+void hud_shutdown(void);
+
+void hud_toggle(void);
+
+bool hud_visible(void);
+
+// Draw frame times, render counters and GPU pass times over the current target
+void hud_draw(int width, int height);
+
+#endif
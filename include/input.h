@@ -6,4 +6,32 @@ void input_init(GLFWwindow* window);
 
 void input_set_camera(Camera* camera);
 
+// Write every frame's keys, mouse motion and delta time to a binary log
+bool input_record_start(const char* path);
+
+// Feed a recorded log back instead of the devices, frame for frame
+bool input_replay_start(const char* path);
+
+// The replay log ran out, input is live again
+bool input_replay_finished(void);
+
+// Snapshot this frame's input, once per frame before anything reads it.
+// Records it, or while replaying replaces it and *deltaTime with the log's
+void input_begin_frame(GLFWwindow* window, float* deltaTime);
+
+bool input_key_down(int key);
+
+// True once per press of key, for toggles and one-shot actions
+bool input_key_pressed(GLFWwindow* window, int key);
+
+// Once per frame: mouse look and toggles
+void input_update_frame(GLFWwindow* window);
+
+// Wireframe drawing, toggled with F1
+bool input_wireframe(void);
+
+// Once per simulation step: movement and room bounds
 void input_update(GLFWwindow* window, float deltaTime, float roomW, float roomH, float roomD);
+
+// Close the record or replay log
+void input_shutdown(void);
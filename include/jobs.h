@@ -0,0 +1,41 @@
+#ifndef JOBS_H
+#define JOBS_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+
+#define JOBS_MAX_WORKERS 12     // the profiler names 16 threads: main, render and these
+#define JOBS_DEQUE_SIZE 1024    // jobs one thread can have queued, pushing past it runs the job inline
+
+typedef void (*JobFn)(void* user);
+
+// Runs items [begin, end) of a jobs_parallel_for
+typedef void (*JobRangeFn)(int begin, int end, void* user);
+
+// Jobs still running, zero it before handing it to jobs_run. It must outlive
+// the jobs, wait on it before it goes out of scope
+typedef struct {
+    atomic_int pending;
+} JobCounter;
+
+// Start `workers` threads, -1 for one per core beside the calling thread.
+// The calling thread becomes the main job thread. With 0 every job runs inline
+bool jobs_init(int workers);
+
+// Runs what is still queued, then ends the workers
+void jobs_shutdown(void);
+
+int jobs_worker_count(void);
+
+// Queue fn(user). counter may be NULL when nobody waits for the job. From a
+// thread that is not the main thread or a worker, the job runs inline
+void jobs_run(JobFn fn, void* user, JobCounter* counter);
+
+// Run queued jobs until the counter drops to zero
+void jobs_wait(JobCounter* counter);
+
+// fn over [0, count) in chunks of at least minChunk items, split across every
+// thread. The caller runs chunks too and returns when all are done
+void jobs_parallel_for(int count, int minChunk, JobRangeFn fn, void* user);
+
+#endif
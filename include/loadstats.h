@@ -0,0 +1,52 @@
+#ifndef LOADSTATS_H
+#define LOADSTATS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define LOADSTATS_MAX_RECORDS 256
+#define LOADSTATS_MAX_DEPTH 4     // a model loads textures and shader variants inside its own record
+
+// Where the time of one asset load goes. Not every kind has every stage:
+// assimp reads its own files (decode = import), shaders have no mips
+// (decode = compile and link, or a program binary from the cache)
+typedef enum {
+    LOAD_READ,      // file to memory
+    LOAD_DECODE,    // image decode, model import, shader compile
+    LOAD_CONVERT,   // into engine layouts
+    LOAD_UPLOAD,    // GL buffers and textures
+    LOAD_MIPS,      // glGenerateMipmap
+    LOAD_STAGE_COUNT
+} LoadStage;
+
+typedef struct {
+    char kind[16];              // "texture", "model", "shader"
+    char path[256];
+    int depth;                  // nested inside another load
+    int64_t bytes;              // read from disk, as far as we see it
+    double stageMs[LOAD_STAGE_COUNT];
+    double totalMs;             // including nested loads
+} LoadRecord;
+
+// Off by default, every call below is then a no-op. GPU stages wait for the
+// GPU (glFinish) while enabled, so upload and mip times are real
+void loadstats_enable(bool enabled);
+
+void loadstats_begin(const char* kind, const char* path);
+
+// The time since the previous mark of this load, minus nested loads, went to stage
+void loadstats_stage(LoadStage stage);
+
+void loadstats_bytes(int64_t bytes);
+
+void loadstats_end(void);
+
+int loadstats_count(void);
+
+const LoadRecord* loadstats_at(int index);
+
+const char* loadstats_stage_name(LoadStage stage);
+
+void loadstats_clear(void);
+
+#endif
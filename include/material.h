@@ -0,0 +1,71 @@
+#ifndef MATERIAL_H
+#define MATERIAL_H
+
+#include "shader.h"
+#include "texture.h"
+#include <cglm/cglm.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define MATERIAL_MAX 1024
+#define MATERIAL_MAX_TEXTURES 128
+#define MATERIAL_UBO_BINDING 0
+
+// Id 0 is the default material: white, surface shader without features
+typedef uint16_t MaterialId;
+#define MATERIAL_DEFAULT 0
+
+typedef enum {
+    MATERIAL_SLOT_ALBEDO,
+    MATERIAL_SLOT_NORMAL,
+    MATERIAL_SLOT_ORM,      // R = AO, G = roughness, B = metalness
+    MATERIAL_SLOT_COUNT
+} MaterialSlot;
+
+// std140 layout of the Material uniform block, factors scale the matching
+// albedo and ORM texels (empty slots sample white)
+typedef struct {
+    vec4 baseColor;
+    float roughness;
+    float metallic;
+    float pad[2];
+} MaterialParams;
+
+typedef struct {
+    char name[64];
+    Shader* shader;
+    int shaderIndex;    // shader_variant_index of shader, sorts draws without reading the GL id
+    const Texture* textures[MATERIAL_SLOT_COUNT]; // texture unit = slot
+    MaterialParams params;
+} Material;
+
+// Create the material table and its uniform buffer. Every material shades
+// with a variant of this surface program
+bool material_system_init(const char* vertPath, const char* fragPath);
+
+void material_system_shutdown(void);
+
+// New material with default parameters, its shader is the surface variant
+// with exactly these features
+MaterialId material_create(const char* name, ShaderFeatures features);
+
+Material* material_get(MaterialId id);
+
+// Upload params after editing them through material_get
+void material_update(MaterialId id);
+
+// Bind the textures and uniform block range of a material, the caller binds its shader
+void material_bind(MaterialId id);
+
+// Forget cached bindings after someone else bound textures or programs
+void material_invalidate_bindings(void);
+
+// Load a texture once, later calls with the same path share it
+const Texture* material_load_texture(const char* path);
+
+// Same, packing up to three grey maps with texture_pack_orm, NULL paths use defaults
+const Texture* material_load_orm(const char* aoPath, const char* roughnessPath, const char* metalnessPath);
+
+int material_count(void);
+
+#endif
@@ -3,12 +3,15 @@
 
 #include <stdbool.h>
 #include <glad/glad.h>
+#include <cglm/cglm.h>
 
 // A simple mesh structure
 typedef struct {
     GLuint VAO, VBO, EBO;
     int vertexCount;
     int indexCount;
+    vec3 bounds[2];     // object space AABB (min, max), for culling
+    GLsizeiptr bufferBytes; // VBO + EBO, reported to the stats
 } Mesh;
 
 // Initialize cube mesh
@@ -20,6 +23,9 @@ bool mesh_init_plane(Mesh* mesh, float width, float depth, int tiles);
 // Draw a mesh
 void mesh_draw(Mesh* mesh);
 
+// Draw with the mesh VAO already bound, lets the renderer skip redundant binds
+void mesh_draw_bound(const Mesh* mesh);
+
 // Destroy OpenGL buffers
 void mesh_destroy(Mesh* mesh);
 
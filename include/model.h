@@ -1,18 +1,40 @@
 #ifndef MODEL_H
 #define MODEL_H
 
+#include "material.h"
 #include "mesh.h"
 #include <stdbool.h>
 
+// Sub-meshes sharing a material, drawn with one glMultiDrawElementsBaseVertex
 typedef struct {
-    Mesh* meshes;
-    int meshCount;
+    int first;                  // first entry in the draw arrays
+    int count;                  // number of sub-meshes
+    int indexCount;             // indices over those sub-meshes, for the stats
+    unsigned int materialIndex; // aiMesh material index
+    MaterialId material;        // imported from the aiMaterial
+} ModelBatch;
+
+typedef struct {
+    Mesh mesh;                  // every sub-mesh packed in one VAO/VBO/EBO
+    int subMeshCount;
+
+    // multi-draw ranges, one per sub-mesh, ordered by material
+    GLsizei* drawCounts;
+    const void** drawOffsets;
+    GLint* drawBaseVertices;
+
+    ModelBatch* batches;
+    int batchCount;
 } Model;
 
+// Import meshes and their materials, textures resolve relative to the model file
 bool model_load(Model* model, const char* path);
 
 void model_draw(Model* model);
 
+// Draw a single material batch
+void model_draw_batch(const Model* model, int batch);
+
 void model_destroy(Model* model);
 
 #endif
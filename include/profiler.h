@@ -0,0 +1,63 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// CPU zones are compiled in only with -DPROFILE (make PROFILE=1), otherwise
+// every macro below expands to nothing
+//
+// Measured cost of one PROFILE_ZONE around an empty body, 20M zones minus the
+// same loop without them, on a virtualized Xeon with make PROFILE=1's flags
+// (-O2): 42 to 48 ns over nine runs, 55 ns without -O2. 40 ns of that are
+// the two TSC reads, which cost 20 ns each on that VM and well under 10 ns
+// on bare metal
+
+#define PROFILER_MAX_THREADS 16
+#define PROFILER_EVENTS_PER_THREAD 65536 // ring per thread, oldest events are overwritten
+#define PROFILER_MAX_FRAMES 256          // frame start marks kept for export
+
+typedef struct {
+    const char* name;
+    uint64_t start;
+} ProfileZone;
+
+#ifdef PROFILE
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+
+// Time the rest of the enclosing block, name must be a string literal
+#define PROFILE_ZONE(name)                                                   \
+    ProfileZone PROFILE_CONCAT(profileZone_, __LINE__)                       \
+        __attribute__((cleanup(profiler_zone_end))) = profiler_zone_begin(name)
+
+// Mark the start of a frame, exports are cut at these marks
+#define PROFILE_FRAME() profiler_frame_mark()
+
+// Label the calling thread in exported traces
+#define PROFILE_THREAD(name) profiler_thread_name(name)
+
+#else
+
+#define PROFILE_ZONE(name) ((void)0)
+#define PROFILE_FRAME() ((void)0)
+#define PROFILE_THREAD(name) ((void)0)
+
+#endif
+
+void profiler_init(void);
+
+ProfileZone profiler_zone_begin(const char* name);
+
+// Records the zone in the calling thread's buffer, used as a cleanup handler
+void profiler_zone_end(ProfileZone* zone);
+
+void profiler_frame_mark(void);
+
+void profiler_thread_name(const char* name);
+
+// Write the last `frames` frames as Chrome trace JSON (chrome://tracing, Perfetto)
+bool profiler_export_chrome(const char* path, int frames);
+
+#endif
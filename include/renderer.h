@@ -1,30 +1,114 @@
 #pragma once
 #include "camera.h"
+#include "material.h"
 #include "mesh.h"
 #include "model.h"
 #include "shader.h"
+#include "skybox.h"
 #include "texture.h"
 #include <cglm/cglm.h>
+#include <stdbool.h>
+#include <stdint.h>
 
 typedef enum { PLANE_FLOOR, PLANE_WALL_X, PLANE_WALL_Z } PlaneType;
 
+// point lights on top of the main light, every surface fragment loops over all
+// of them (shaders/lights.glsl)
+#define RENDERER_MAX_POINT_LIGHTS 64
+#define RENDERER_LIGHTS_UBO_BINDING 1
+
+// std140 element of the Lights uniform block
+typedef struct {
+  vec4 positionRadius; // xyz world position, w radius of influence
+  vec4 color;          // rgb intensity, w unused
+} PointLight;
+
+// one queued draw, either a whole mesh or one material batch of a model
+typedef struct {
+  uint64_t key; // filled when the list is sorted, on the GL thread
+  const Mesh *mesh;
+  const Model *model; // NULL for plain meshes
+  int batch;
+  MaterialId material;
+  mat4 transform;
+} DrawCommand;
+
+// Everything one frame draws. Built without GL between renderer_begin_list
+// and renderer_end_list by the set_* and draw_* calls, then handed to the GL
+// thread, which may only reorder it
+typedef struct {
+  mat4 projection;
+  mat4 view;
+  vec3 lightPos;
+  PointLight lights[RENDERER_MAX_POINT_LIGHTS];
+  int lightCount;
+  bool wireframe;
+  DrawCommand *draws; // the ones that passed culling after renderer_end_list
+  int drawCount;
+  int drawCapacity;
+  unsigned char *visible; // culling results, drawCapacity long
+  int culled;
+} RenderList;
+
 bool renderer_init(void);
 
 void renderer_shutdown(void);
 
-void renderer_set_shader(Shader *shader);
+// --------------------------------------------------
+// Building a frame: no GL, one thread at a time
+// --------------------------------------------------
+
+// The set_* and draw_* calls below go into list until renderer_end_list. It
+// starts from the projection, light and point lights last set
+void renderer_begin_list(RenderList *list);
 
+// Drop the draws outside the view frustum, tested on every job thread
+void renderer_end_list(void);
+
+void renderer_list_free(RenderList *list);
+
+// Settings last from one list to the next, also when set between lists
 void renderer_set_projection(mat4 proj);
 
 void renderer_set_view(mat4 view);
 
 void renderer_set_light(vec3 pos);
 
-void renderer_clear(vec4 color);
+// Replace the point lights, at most RENDERER_MAX_POINT_LIGHTS are kept
+void renderer_set_point_lights(const PointLight *lights, int count);
+
+void renderer_set_wireframe(bool enabled);
 
-void renderer_draw_mesh(const Mesh *mesh, const Texture *tex, mat4 model);
+// The draw_* calls only queue into the list, nothing reaches GL before
+// renderer_flush
+void renderer_draw_mesh(const Mesh *mesh, MaterialId material, mat4 model);
 
+// One queued draw per material batch of the model
 void renderer_draw_model(const Model *model, mat4 modelMatrix);
 
-void renderer_draw_quad(const Mesh *plane, const Texture *tex, vec3 pos,
+void renderer_draw_quad(const Mesh *plane, MaterialId material, vec3 pos,
                         float width, float height, PlaneType type);
+
+// --------------------------------------------------
+// Executing a frame: the thread with the GL context
+// --------------------------------------------------
+
+// Draw from list until the next call: uploads its lights and state
+void renderer_use_list(RenderList *list);
+
+void renderer_clear(vec4 color);
+
+// Depth only, for frames where the sky covers every pixel geometry does not
+void renderer_clear_depth(void);
+
+// Sort the list in use by shader, material and depth, then draw it
+void renderer_flush(void);
+
+// Draw after opaque geometry, the sky only fills pixels left at the far plane
+void renderer_draw_skybox(const Skybox *sky);
+
+// Alpha blended 2D triangles in pixel coordinates (origin top-left) on top of
+// everything, e.g. the HUD. Not counted in the stats it may be displaying
+void renderer_draw_overlay(const Shader *shader, const Texture *texture,
+                           unsigned int vao, int vertexCount, int width,
+                           int height);
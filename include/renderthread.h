@@ -0,0 +1,41 @@
+#ifndef RENDERTHREAD_H
+#define RENDERTHREAD_H
+
+#include "renderer.h"
+#include "timing.h"
+#include "window.h"
+#include <stdbool.h>
+
+#define RENDERTHREAD_MAX_PACKETS 3  // frames in flight: 1 renders inline, 2 or 3 on the render thread
+
+// One frame as the main thread hands it over. Nothing in it may be touched
+// between renderthread_submit and the packet coming back from
+// renderthread_acquire
+typedef struct {
+    int frame;
+    RenderList list;            // view, lights and the draws that passed culling
+    FrameTimestamps times;      // start and cpuDone from the main thread, present from the render thread
+    float frameMs;              // main thread, frame start to frame start
+    float cpuMs;                // main thread work, the render thread adds its own
+    bool dumpStats;             // F2
+    bool toggleHud;             // F4
+    const char* screenshotPath; // save this frame before presenting it, NULL for no
+} FramePacket;
+
+// Draws a packet on the thread with the GL context, before it is presented
+typedef void (*RenderFrameFn)(FramePacket* packet, void* user);
+
+// Hand the window's context to a render thread with `packets` frames in
+// flight. With 1 there is no thread, renderthread_submit draws inline
+bool renderthread_start(Window* window, int packets, RenderFrameFn render, void* user);
+
+// The packet to build the next frame in, waits while every packet is in flight
+FramePacket* renderthread_acquire(void);
+
+// Queue the packet for drawing and presenting
+void renderthread_submit(FramePacket* packet);
+
+// Draw what is queued, end the thread and make the context current here again
+void renderthread_stop(void);
+
+#endif
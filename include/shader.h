@@ -1,19 +1,84 @@
 #pragma once
 #include <stdbool.h>
+#include <stdint.h>
+
+// Feature bits of a shader variant, each one becomes a #define in the GLSL
+typedef uint32_t ShaderFeatures;
+#define SHADER_FEATURE_NORMAL_MAP (1u << 0) // NORMAL_MAP: tangent-space normal map
+#define SHADER_FEATURE_PBR        (1u << 1) // PBR: Cook-Torrance with the ORM map
+
+#define SHADER_MAX_VARIANTS 64
+
+// Linked program binaries are cached here, relative to the working directory
+#define SHADER_CACHE_DIR ".shadercache"
 
 typedef struct {
     unsigned int id;
+    ShaderFeatures features;
     int modelLoc;
     int viewLoc;
     int projLoc;
     int lightPosLoc;
+    bool prepared;      // samplers and blocks set up by the material system, false for every new program
 } Shader;
 
+typedef struct {
+    int programs;      // programs requested through shader_load*
+    int binaryHits;    // loaded from SHADER_CACHE_DIR
+    int binaryRejects; // cached binary refused by the driver, recompiled
+    int compiled;      // compiled and linked from source
+} ShaderCacheStats;
+
 bool shader_load(Shader* shader,
                  const char* vert_path,
                  const char* frag_path);
 
+// Compile with the feature #defines injected after #version
+bool shader_load_variant(Shader* shader,
+                         const char* vert_path,
+                         const char* frag_path,
+                         ShaderFeatures features);
+
+// Start compiling a variant owned by the shader cache and return at once.
+// Its id is valid right away, but it must not be drawn with before
+// shader_poll_pending or shader_finish_pending has resolved it
+Shader* shader_request_variant(const char* vert_path,
+                               const char* frag_path,
+                               ShaderFeatures features);
+
+// Slot of a cached variant, fixed for the life of the cache. Hot reload
+// changes the program id but never the slot. -1 for shaders not from the cache
+int shader_variant_index(const Shader* shader);
+
+// Same, waiting for the variant to link. Returns NULL if it does not compile
+Shader* shader_get_variant(const char* vert_path,
+                           const char* frag_path,
+                           ShaderFeatures features);
+
+// Resolve every requested variant the driver has finished with, returns how
+// many are still compiling. Without KHR_parallel_shader_compile nothing can be
+// checked without blocking, so this only counts
+int shader_poll_pending(void);
+
+// Wait for every requested variant, false if any of them failed to link
+bool shader_finish_pending(void);
+
+ShaderCacheStats shader_cache_stats(void);
+
+// Watch a shader directory (inotify) for hot reload
+bool shader_watch_init(const char* dir);
+
+// Rebuild the cached variants whose files changed since the last call, in
+// place. Never blocks when nothing changed. Returns how many were swapped
+int shader_watch_poll(void);
+
+// Destroy every cached variant and stop watching
+void shader_cache_shutdown(void);
+
 void shader_bind(const Shader* shader);
 void shader_destroy(Shader* shader);
 
 int shader_get_uniform(const Shader* shader, const char* name);
+
+// Point a uniform block at a buffer binding point, no-op if the shader lacks it
+void shader_bind_uniform_block(const Shader* shader, const char* name, unsigned int binding);
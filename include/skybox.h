@@ -0,0 +1,20 @@
+#ifndef SKYBOX_H
+#define SKYBOX_H
+
+#include "mesh.h"
+#include "shader.h"
+#include "texture.h"
+#include <stdbool.h>
+
+typedef struct {
+    Texture cubemap;
+    Mesh cube;
+    Shader* shader; // owned by the shader cache, so it hot reloads
+} Skybox;
+
+// Load the cubemap (equirectangular image or face directory) and the sky shader
+bool skybox_load(Skybox* sky, const char* path);
+
+void skybox_destroy(Skybox* sky);
+
+#endif
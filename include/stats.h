@@ -0,0 +1,60 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+// Counters reset every frame, gauges hold a running total
+typedef enum {
+    STAT_DRAW_CALLS,
+    STAT_TRIANGLES,
+    STAT_STATE_CHANGES,    // program, VAO, texture and uniform buffer binds
+    STAT_OBJECTS_VISIBLE,  // queued draws that passed culling
+    STAT_OBJECTS_CULLED,
+    STAT_TEXTURE_BYTES,    // gauge: texture memory alive
+    STAT_BUFFER_BYTES,     // gauge: buffer memory alive
+    STAT_COUNT
+} StatId;
+
+#define STAT_FIRST_GAUGE STAT_TEXTURE_BYTES
+
+// Frame time series, in milliseconds
+typedef enum {
+    STATS_FRAME_MS,        // frame to frame, includes waiting on the swap
+    STATS_CPU_MS,          // work of the main and render threads on the frame, before the swap
+    STATS_SERIES_COUNT
+} StatsSeries;
+
+#define STATS_HISTORY 240  // samples kept per series
+
+typedef struct {
+    float last, avg, p50, p95, p99, max;
+} StatsTimes;
+
+// written from the thread that renders only, read through stats_get
+extern int64_t statsCurrent[STAT_COUNT];
+
+// Cheap enough for every draw call
+static inline void stats_add(StatId id, int64_t amount) {
+    statsCurrent[id] += amount;
+}
+
+// Close the frame: counters move to the readable set and restart at zero
+void stats_end_frame(float frameMs, float cpuMs);
+
+// Counters of the last finished frame, gauges as of now
+int64_t stats_get(StatId id);
+
+const char* stats_name(StatId id);
+
+StatsTimes stats_times(StatsSeries series);
+
+// Sample `age` frames back (0 = last finished frame), 0 when not recorded yet
+float stats_sample(StatsSeries series, int age);
+
+int stats_sample_count(StatsSeries series);
+
+// One line per stat, for logs and headless runs
+void stats_dump(FILE* out);
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef STREAMBUF_H
+#define STREAMBUF_H
+
+#include <stdbool.h>
+#include <glad/glad.h>
+
+#define STREAMBUF_MAX_REGIONS 4
+
+// One GL buffer split into per-frame regions. The CPU writes region N while
+// the GPU is still reading regions N-1.., each region guarded by a fence.
+typedef struct {
+    GLuint id;
+    GLsizeiptr regionSize;
+    int regionCount;
+    int region;                 // region written this frame
+    GLsizeiptr head;            // write cursor inside the current region
+    GLsync fences[STREAMBUF_MAX_REGIONS];
+    unsigned char *persistent;  // whole-buffer mapping (ARB_buffer_storage), NULL otherwise
+    bool mapped;                // a glMapBufferRange is outstanding
+    int orphans;                // busy regions replaced instead of waited on
+} StreamBuffer;
+
+// Create the buffer: regionCount regions (2-4) of regionSize bytes each
+bool streambuf_init(StreamBuffer *sb, GLsizeiptr regionSize, int regionCount);
+
+// Reserve size bytes (offset aligned to align, a power of two) in this frame's region.
+// Returns the write pointer and the absolute buffer offset, or NULL if the region is full.
+void *streambuf_map(StreamBuffer *sb, GLsizeiptr size, GLsizeiptr align, GLintptr *offset);
+
+// Finish the writes of the last streambuf_map
+void streambuf_unmap(StreamBuffer *sb);
+
+// Fence the current region and move to the next one, call once per frame after submission
+void streambuf_end_frame(StreamBuffer *sb);
+
+// Destroy the buffer and its fences
+void streambuf_destroy(StreamBuffer *sb);
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef STRESS_H
+#define STRESS_H
+
+#include "material.h"
+#include "mesh.h"
+#include "model.h"
+#include "renderer.h"
+#include "texture.h"
+#include <cglm/cglm.h>
+#include <stdbool.h>
+
+#define STRESS_HIERARCHY_CHAINS 16   // chains of the hierarchy scene, each `count` nodes deep
+
+typedef enum {
+    STRESS_CHAIRS,      // count chairs on a grid, one shared model
+    STRESS_LIGHTS,      // count orbiting point lights over the room
+    STRESS_QUADS,       // count quads, each with its own texture and material
+    STRESS_HIERARCHY,   // STRESS_HIERARCHY_CHAINS spinning chains, count nodes deep
+} StressKind;
+
+// One transform of the hierarchy scene, parents come before their children
+typedef struct {
+    int parent;         // -1 for roots
+    vec3 offset;        // from the parent
+    float spin;         // radians per second about the local Y axis
+    mat4 world;         // at the latest step
+    mat4 previous;      // at the step before, drawn blended with world
+} StressNode;
+
+typedef struct {
+    StressKind kind;
+    int count;
+    float time;         // simulated seconds, advanced by stress_update
+
+    const Model* chair;
+    const Mesh* plane;
+    Mesh cube;
+    bool hasCube;
+
+    mat4* transforms;   // chairs, quads and hierarchy nodes as drawn
+    int transformCount;
+    MaterialId* materials;
+    Texture* textures;
+    int textureCount;
+
+    StressNode* nodes;
+    int nodeCount;
+
+    PointLight* lights; // as drawn
+    float* lightOrbits; // radius, height, speed, phase per light
+    vec3* lightFrom;    // positions at the step before and the latest step
+    vec3* lightTo;
+    int lightCount;
+} StressScene;
+
+// Build a scene from "kind:count[:seed]", kind one of chairs, lights, quads,
+// hierarchy. The same spec and seed always give the same scene
+bool stress_create(StressScene* scene, const char* spec, const Model* chair, const Mesh* plane);
+
+// Animate by one fixed simulation step
+void stress_update(StressScene* scene, float deltaTime);
+
+// Blend the last two steps for drawing, alpha 0 is the one before the latest.
+// Once per frame after the frame's updates, before stress_draw
+void stress_interpolate(StressScene* scene, float alpha);
+
+// Queue the scene's draws, inside a pass before renderer_flush
+void stress_draw(const StressScene* scene);
+
+void stress_destroy(StressScene* scene);
+
+#endif
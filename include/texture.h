@@ -5,14 +5,26 @@
 
 typedef struct {
     unsigned int id;    // OpenGL texture ID
+    unsigned int target; // GL_TEXTURE_2D or GL_TEXTURE_CUBE_MAP
     int width;
     int height;
     int channels;       // Number of color channels (e.g., 3=RGB, 4=RGBA)
 } Texture;
 
+/* Create a texture from 1, 3 or 4 channel 8-bit pixels */
+bool texture_create(Texture *texture, int width, int height, int channels, const unsigned char *pixels);
+
 /* Load a texture from a file */
 bool texture_load(Texture *texture, const char *path);
 
+/* Pack three grey maps into one RGB texture: R = AO, G = roughness, B = metalness.
+   Any path may be NULL or missing, its channel then holds 1, 1 and 0 respectively */
+bool texture_pack_orm(Texture *texture, const char *aoPath, const char *roughnessPath, const char *metalnessPath);
+
+/* Load a cubemap from one equirectangular image, or from a directory holding
+   px/nx/py/ny/pz/nz faces. Equirectangular images are resampled to faces here, once */
+bool texture_load_cubemap(Texture *texture, const char *path);
+
 /* Bind a texture to a texture unit */
 void texture_bind(const Texture *texture, unsigned int unit);
 
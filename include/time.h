@@ -1,7 +0,0 @@
-#ifndef TIME_H
-#define TIME_H
-
-float time_update(void);        // Call once per frame to update delta time
-// float time_get_delta(void);    // Get deltaTime for this frame NOT USED ANYMORE
-
-#endif
\ No newline at end of file
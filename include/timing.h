@@ -0,0 +1,38 @@
+#ifndef TIMING_H
+#define TIMING_H
+
+#include <stdint.h>
+
+// Where one frame spent its time, nanoseconds on the time_now_ns clock
+typedef struct {
+    uint64_t start;             // time_update
+    uint64_t cpuDone;           // time_frame_cpu_done, before the swap
+    uint64_t present;           // time_frame_presented, once the swap returned
+} FrameTimestamps;
+
+uint64_t time_now_ns(void);     // Nanoseconds since the first call, monotonic
+double time_now(void);          // The same clock in seconds
+
+float time_update(void);        // Call once per frame to update delta time, starts the frame
+// float time_get_delta(void);    // Get deltaTime for this frame NOT USED ANYMORE
+
+// Mark the end of the frame's CPU work, returns it in milliseconds
+float time_frame_cpu_done(void);
+
+// Start and cpuDone of the frame being built, to send along with it
+FrameTimestamps time_frame_marks(void);
+
+// Mark the swap of frame returning, on the thread that presents
+void time_frame_presented(FrameTimestamps* frame);
+
+// The last frame with all three marks, on the thread that presents
+FrameTimestamps time_last_frame(void);
+
+// Cap the frame rate at fps, 0 removes the cap
+void time_set_frame_limit(double fps);
+
+// Wait until the next frame is due, after the swap. Sleeps most of the way
+// and spins the rest, returns at once without a limit
+void time_limit_frame(void);
+
+#endif
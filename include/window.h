@@ -9,18 +9,54 @@
 #define WINDOW_HEIGHT 1080.f
 
 typedef struct Window {
-    GLFWwindow *handle;
+    GLFWwindow *handle;         // NULL when headless
     int width;
     int height;
     const char *title;
+
+    // headless: an EGL context without any display, drawing into an FBO
+    bool headless;
+    unsigned int framebuffer;   // what "the screen" is, 0 unless headless
+    unsigned int colorBuffer, depthBuffer;
+    void *eglDisplay, *eglContext, *eglSurface;
 } Window;
 
+// Ask for a debug context (KHR_debug output) from the next window_create
+void window_hint_debug(bool enable);
+
+// Render offscreen through EGL (surfaceless or pbuffer, e.g. Mesa llvmpipe)
+// from the next window_create, nothing needs a display. Linux only
+void window_hint_headless(bool enable);
+
 bool window_create(Window *window, int width, int height, const char *title);
 
+typedef enum {
+    WINDOW_VSYNC_OFF,           // present as fast as possible, may tear
+    WINDOW_VSYNC_ON,            // wait for vblank
+    WINDOW_VSYNC_ADAPTIVE,      // wait for vblank, tear instead of halving the rate on a late frame
+} WindowVsync;
+
+// Swap interval. Adaptive needs EXT_swap_control_tear and falls back to on
+void window_set_vsync(Window *window, WindowVsync mode);
+
+// Present the frame: swap, or a flush when headless. From the thread that has the context
+void window_present(Window *window);
+
+// Handle window events, from the thread that created the window
+void window_poll_events(Window *window);
+
+// window_present then window_poll_events, for single threaded loops
 void window_update(Window *window);
 
+// Make the GL context current on the calling thread, or release it so
+// another thread can take it. A context is current on one thread at a time
+bool window_make_current(Window *window, bool current);
+
 bool window_should_close(Window *window);
 
+// Write what was last rendered as a binary PPM, for image tests and batch runs
+bool window_save_ppm(Window *window, const char *path);
+
 void window_destroy(Window *window);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,19 @@
+// Point lights from renderer_set_point_lights, at most RENDERER_MAX_POINT_LIGHTS
+#define MAX_POINT_LIGHTS 64
+
+struct PointLight {
+    vec4 positionRadius; // xyz position, w radius of influence
+    vec4 color;
+};
+
+layout(std140) uniform Lights {
+    ivec4 pointLightCount; // x
+    PointLight pointLights[MAX_POINT_LIGHTS];
+};
+
+// inverse square, windowed to reach zero at the radius
+float pointLightAttenuation(float distance, float radius) {
+    float ratio = distance / radius;
+    float window = clamp(1.0 - ratio * ratio * ratio * ratio, 0.0, 1.0);
+    return window * window / (distance * distance + 1.0);
+}
@@ -0,0 +1,5 @@
+// Per-material parameters, one range of the material uniform buffer
+layout(std140) uniform Material {
+    vec4 baseColor;
+    vec4 materialParams; // x roughness, y metallic
+};
@@ -0,0 +1,64 @@
+// Cook-Torrance BRDF for the main light and the point lights of lights.glsl
+
+const float PI = 3.14159265359;
+const vec3 lightColor = vec3(4.0);
+const vec3 ambientColor = vec3(0.25);
+
+// GGX / Trowbridge-Reitz normal distribution
+float distributionGGX(float NdotH, float roughness) {
+    float a = roughness * roughness;
+    float a2 = a * a;
+    float d = NdotH * NdotH * (a2 - 1.0) + 1.0;
+    return a2 / (PI * d * d);
+}
+
+// Smith geometry term with the Schlick-GGX approximation, direct lighting k
+float geometrySmith(float NdotV, float NdotL, float roughness) {
+    float r = roughness + 1.0;
+    float k = r * r / 8.0;
+    float gv = NdotV / (NdotV * (1.0 - k) + k);
+    float gl = NdotL / (NdotL * (1.0 - k) + k);
+    return gv * gl;
+}
+
+vec3 fresnelSchlick(float cosTheta, vec3 F0) {
+    return F0 + (1.0 - F0) * pow(clamp(1.0 - cosTheta, 0.0, 1.0), 5.0);
+}
+
+// light reflected towards V from one light of the given radiance
+vec3 directPBR(vec3 albedo, float roughness, float metallic, vec3 N, vec3 V, vec3 L, vec3 radiance) {
+    vec3 H = normalize(V + L);
+    float NdotV = max(dot(N, V), 1e-4);
+    float NdotL = max(dot(N, L), 0.0);
+    float NdotH = max(dot(N, H), 0.0);
+
+    vec3 F0 = mix(vec3(0.04), albedo, metallic);
+    vec3 F = fresnelSchlick(max(dot(H, V), 0.0), F0);
+    float D = distributionGGX(NdotH, roughness);
+    float G = geometrySmith(NdotV, NdotL, roughness);
+
+    vec3 specular = D * G * F / (4.0 * NdotV * max(NdotL, 1e-4));
+    vec3 kd = (1.0 - F) * (1.0 - metallic);
+    return (kd * albedo / PI + specular) * radiance * NdotL;
+}
+
+// albedo in linear space, orm = (AO, roughness, metalness), P world position,
+// returns display color
+vec3 shadePBR(vec3 albedo, vec3 orm, vec3 P, vec3 N, vec3 V, vec3 L) {
+    float ao = orm.r;
+    float roughness = clamp(orm.g, 0.04, 1.0);
+    float metallic = orm.b;
+
+    vec3 color = ambientColor * albedo * ao + directPBR(albedo, roughness, metallic, N, V, L, lightColor);
+    for (int i = 0; i < pointLightCount.x; i++) {
+        vec3 toLight = pointLights[i].positionRadius.xyz - P;
+        float distance = length(toLight);
+        float attenuation = pointLightAttenuation(distance, pointLights[i].positionRadius.w);
+        color += directPBR(albedo, roughness, metallic, N, V, toLight / distance,
+                           pointLights[i].color.rgb * attenuation);
+    }
+
+    // Reinhard, then back to display gamma
+    color = color / (color + 1.0);
+    return pow(color, vec3(1.0 / 2.2));
+}
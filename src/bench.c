@@ -0,0 +1,291 @@
+#include <glad/glad.h>
+#include "bench.h"
+#include "gputimer.h"
+#include "stats.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+
+/*
+
+   the bench module should only drive a reproducible run and report on it
+   it should NOT render anything, main renders the frames as usual
+
+   the camera follows a keyframed path sampled at a fixed time step, so two
+   runs of the same script draw exactly the same frames no matter how fast
+   the machine is. only the measured frames count, GPU times are matched to
+   the frame that produced them
+
+   OWNS: the camera script, per-frame samples of the measured frames
+
+   input: script file, stats and GPU timers after every frame
+   output: a JSON report
+
+*/
+
+static int compare_key(const void* a, const void* b) {
+    float ta = ((const BenchKey*)a)->time, tb = ((const BenchKey*)b)->time;
+    return ta < tb ? -1 : (ta > tb);
+}
+
+bool bench_load(Bench* bench, const char* path) {
+    memset(bench, 0, sizeof(*bench));
+    bench->warmupFrames = 60;
+    bench->dt = 1.0f / 60.0f;
+    for (int i = 0; i < GPU_TIMER_MAX_NAMES; i++) bench->zoneHeads[i] = -1;
+
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        fprintf(stderr, "Cannot open bench script %s\n", path);
+        return false;
+    }
+
+    char line[256];
+    int lineNumber = 0;
+    bool ok = true;
+    while (ok && fgets(line, sizeof(line), f)) {
+        lineNumber++;
+        char* comment = strchr(line, '#');
+        if (comment) *comment = '\0';
+
+        char word[16];
+        if (sscanf(line, "%15s", word) != 1) continue;
+
+        if (strcmp(word, "warmup") == 0) {
+            ok = sscanf(line, "%*s %d", &bench->warmupFrames) == 1 && bench->warmupFrames >= 0;
+        } else if (strcmp(word, "frames") == 0) {
+            ok = sscanf(line, "%*s %d", &bench->measuredFrames) == 1 && bench->measuredFrames > 0;
+        } else if (strcmp(word, "dt") == 0) {
+            ok = sscanf(line, "%*s %f", &bench->dt) == 1 && bench->dt > 0.0f;
+        } else if (strcmp(word, "key") == 0) {
+            if (bench->keyCount == BENCH_MAX_KEYS) {
+                fprintf(stderr, "%s:%d: more than %d keys\n", path, lineNumber, BENCH_MAX_KEYS);
+                ok = false;
+                break;
+            }
+            BenchKey* k = &bench->keys[bench->keyCount++];
+            ok = sscanf(line, "%*s %f %f %f %f %f %f", &k->time, &k->position[0], &k->position[1],
+                        &k->position[2], &k->yaw, &k->pitch) == 6;
+        } else {
+            ok = false;
+        }
+        if (!ok) fprintf(stderr, "%s:%d: cannot parse '%s'\n", path, lineNumber, word);
+    }
+    fclose(f);
+
+    if (ok && bench->keyCount == 0) {
+        fprintf(stderr, "%s: no camera keys\n", path);
+        ok = false;
+    }
+    if (!ok) return false;
+
+    qsort(bench->keys, bench->keyCount, sizeof(BenchKey), compare_key);
+
+    // by default the measured frames cover the path once
+    if (bench->measuredFrames == 0) {
+        float duration = bench->keys[bench->keyCount - 1].time - bench->keys[0].time;
+        bench->measuredFrames = (int)ceilf(duration / bench->dt) + 1;
+    }
+
+    bench->cpuMs = calloc(bench->measuredFrames, sizeof(float));
+    bench->frameMs = calloc(bench->measuredFrames, sizeof(float));
+    return bench->cpuMs && bench->frameMs;
+}
+
+int bench_total_frames(const Bench* bench) {
+    return bench->warmupFrames + bench->measuredFrames + GPU_TIMER_FRAMES;
+}
+
+static float catmull_rom(float p0, float p1, float p2, float p3, float t) {
+    float t2 = t * t, t3 = t2 * t;
+    return 0.5f * (2.0f * p1 + (p2 - p0) * t +
+                   (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * t2 +
+                   (3.0f * p1 - p0 - 3.0f * p2 + p3) * t3);
+}
+
+void bench_camera(const Bench* bench, int frame, Camera* camera) {
+    // warm-up holds the first key, the GPU drain holds the last one
+    int measured = frame - bench->warmupFrames;
+    if (measured < 0) measured = 0;
+    if (measured >= bench->measuredFrames) measured = bench->measuredFrames - 1;
+    float time = bench->keys[0].time + measured * bench->dt;
+
+    const BenchKey* keys = bench->keys;
+    int last = bench->keyCount - 1;
+    int segment = 0;
+    while (segment < last - 1 && time >= keys[segment + 1].time) segment++;
+
+    if (last == 0 || time <= keys[0].time) {
+        camera_set_pose(camera, (float*)keys[0].position, keys[0].yaw, keys[0].pitch);
+        return;
+    }
+    if (time >= keys[last].time) {
+        camera_set_pose(camera, (float*)keys[last].position, keys[last].yaw, keys[last].pitch);
+        return;
+    }
+
+    // end points repeat so the path starts and stops on its keys
+    const BenchKey* k0 = &keys[segment > 0 ? segment - 1 : 0];
+    const BenchKey* k1 = &keys[segment];
+    const BenchKey* k2 = &keys[segment + 1];
+    const BenchKey* k3 = &keys[segment + 2 <= last ? segment + 2 : last];
+    float span = k2->time - k1->time;
+    float t = span > 0.0f ? (time - k1->time) / span : 1.0f;
+
+    vec3 position;
+    for (int c = 0; c < 3; c++)
+        position[c] = catmull_rom(k0->position[c], k1->position[c], k2->position[c], k3->position[c], t);
+    float yaw = catmull_rom(k0->yaw, k1->yaw, k2->yaw, k3->yaw, t);
+    float pitch = catmull_rom(k0->pitch, k1->pitch, k2->pitch, k3->pitch, t);
+    camera_set_pose(camera, position, yaw, pitch);
+}
+
+static BenchZone* find_zone(Bench* bench, const char* name) {
+    for (int i = 0; i < bench->zoneCount; i++)
+        if (bench->zones[i].name == name) return &bench->zones[i];
+
+    if (bench->zoneCount == GPU_TIMER_MAX_NAMES) return NULL;
+    float* ms = calloc(bench->measuredFrames, sizeof(float));
+    if (!ms) return NULL;
+    BenchZone* zone = &bench->zones[bench->zoneCount++];
+    zone->name = name;
+    zone->ms = ms;
+    zone->count = 0;
+    return zone;
+}
+
+void bench_record(Bench* bench, int frame, float frameMs, float cpuMs) {
+    // a GPU result read this frame belongs to the frame that left the query ring
+    int source = frame - GPU_TIMER_FRAMES - bench->warmupFrames;
+    for (int i = 0; i < gputimer_stats_count() && i < GPU_TIMER_MAX_NAMES; i++) {
+        const GpuTimerStats* gpu = gputimer_stats_at(i);
+        if (gpu->head == bench->zoneHeads[i]) continue;
+        bench->zoneHeads[i] = gpu->head;
+        if (source < 0 || source >= bench->measuredFrames) continue;
+
+        BenchZone* zone = find_zone(bench, gpu->name);
+        if (zone && zone->count < bench->measuredFrames) zone->ms[zone->count++] = gpu->last;
+    }
+
+    int measured = frame - bench->warmupFrames;
+    if (measured < 0 || measured >= bench->measuredFrames) return;
+
+    bench->cpuMs[measured] = cpuMs;
+    bench->frameMs[measured] = frameMs;
+
+    int64_t draws = stats_get(STAT_DRAW_CALLS);
+    int64_t triangles = stats_get(STAT_TRIANGLES);
+    bench->drawCalls += draws;
+    bench->triangles += triangles;
+    bench->stateChanges += stats_get(STAT_STATE_CHANGES);
+    if (draws > bench->maxDrawCalls) bench->maxDrawCalls = draws;
+    if (triangles > bench->maxTriangles) bench->maxTriangles = triangles;
+
+    int64_t textureBytes = stats_get(STAT_TEXTURE_BYTES);
+    int64_t bufferBytes = stats_get(STAT_BUFFER_BYTES);
+    if (textureBytes > bench->peakTextureBytes) bench->peakTextureBytes = textureBytes;
+    if (bufferBytes > bench->peakBufferBytes) bench->peakBufferBytes = bufferBytes;
+}
+
+static int compare_float(const void* a, const void* b) {
+    float fa = *(const float*)a, fb = *(const float*)b;
+    return fa < fb ? -1 : (fa > fb);
+}
+
+static void write_times(FILE* f, const char* indent, const char* name, const float* samples, int count,
+                        bool last) {
+    float* sorted = malloc(sizeof(float) * (count > 0 ? count : 1));
+    if (count > 0) memcpy(sorted, samples, sizeof(float) * count);
+    qsort(sorted, count, sizeof(float), compare_float);
+
+    double sum = 0.0;
+    for (int i = 0; i < count; i++) sum += sorted[i];
+
+    fprintf(f, "%s\"%s\": {\"samples\": %d", indent, name, count);
+    if (count > 0) {
+        fprintf(f, ", \"avg\": %.4f, \"min\": %.4f, \"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f",
+                sum / count, sorted[0], sorted[count * 50 / 100], sorted[count * 95 / 100],
+                sorted[count * 99 / 100], sorted[count - 1]);
+    }
+
+    // in frame order, for comparisons that resample them
+    fprintf(f, ",\n%s  \"values\": [", indent);
+    for (int i = 0; i < count; i++) fprintf(f, "%s%.4f", i ? "," : "", samples[i]);
+    fprintf(f, "]}%s\n", last ? "" : ",");
+    free(sorted);
+}
+
+static void write_json_string(FILE* f, const char* s) {
+    fputc('"', f);
+    for (; s && *s; s++) {
+        if (*s == '"' || *s == '\\') fputc('\\', f);
+        if ((unsigned char)*s >= 0x20) fputc(*s, f);
+    }
+    fputc('"', f);
+}
+
+bool bench_write_report(const Bench* bench, const char* scriptPath, const char* scene,
+                        const char* reportPath, int width, int height) {
+    FILE* f = fopen(reportPath, "w");
+    if (!f) {
+        fprintf(stderr, "Cannot write bench report %s\n", reportPath);
+        return false;
+    }
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    int frames = bench->measuredFrames;
+
+    fprintf(f, "{\n  \"script\": ");
+    write_json_string(f, scriptPath);
+    fprintf(f, ",\n  \"scene\": ");
+    write_json_string(f, scene);
+    fprintf(f, ",\n  \"renderer\": ");
+    write_json_string(f, (const char*)glGetString(GL_RENDERER));
+    fprintf(f, ",\n  \"glVersion\": ");
+    write_json_string(f, (const char*)glGetString(GL_VERSION));
+    fprintf(f, ",\n  \"width\": %d,\n  \"height\": %d,\n", width, height);
+    fprintf(f, "  \"warmupFrames\": %d,\n  \"frames\": %d,\n  \"dt\": %.6f,\n",
+            bench->warmupFrames, frames, bench->dt);
+
+    write_times(f, "  ", "cpuMs", bench->cpuMs, frames, false);
+    write_times(f, "  ", "frameMs", bench->frameMs, frames, false);
+
+    // "frame" is the whole GPU frame, the rest are frame graph passes
+    const BenchZone* gpuFrame = NULL;
+    for (int i = 0; i < bench->zoneCount; i++)
+        if (strcmp(bench->zones[i].name, "frame") == 0) gpuFrame = &bench->zones[i];
+    write_times(f, "  ", "gpuMs", gpuFrame ? gpuFrame->ms : NULL, gpuFrame ? gpuFrame->count : 0, false);
+
+    fprintf(f, "  \"passes\": {\n");
+    int passes = bench->zoneCount - (gpuFrame ? 1 : 0), written = 0;
+    for (int i = 0; i < bench->zoneCount; i++) {
+        const BenchZone* zone = &bench->zones[i];
+        if (zone == gpuFrame) continue;
+        write_times(f, "    ", zone->name, zone->ms, zone->count, ++written == passes);
+    }
+    fprintf(f, "  },\n");
+
+    fprintf(f, "  \"drawCalls\": {\"avg\": %.2f, \"max\": %lld},\n",
+            (double)bench->drawCalls / frames, (long long)bench->maxDrawCalls);
+    fprintf(f, "  \"triangles\": {\"avg\": %.2f, \"max\": %lld},\n",
+            (double)bench->triangles / frames, (long long)bench->maxTriangles);
+    fprintf(f, "  \"stateChanges\": {\"avg\": %.2f},\n", (double)bench->stateChanges / frames);
+    fprintf(f, "  \"peakTextureBytes\": %lld,\n  \"peakBufferBytes\": %lld,\n",
+            (long long)bench->peakTextureBytes, (long long)bench->peakBufferBytes);
+    fprintf(f, "  \"peakRssKb\": %ld\n}\n", usage.ru_maxrss);
+    fclose(f);
+
+    printf("Bench: %d frames, report in %s\n", frames, reportPath);
+    return true;
+}
+
+void bench_destroy(Bench* bench) {
+    free(bench->cpuMs);
+    free(bench->frameMs);
+    for (int i = 0; i < bench->zoneCount; i++) free(bench->zones[i].ms);
+    bench->cpuMs = bench->frameMs = NULL;
+    bench->zoneCount = 0;
+}
@@ -79,6 +79,13 @@ void camera_process_mouse(Camera* cam, float xoffset, float yoffset, bool constr
     camera_update_vectors(cam);
 }
 
+void camera_set_pose(Camera* cam, vec3 position, float yaw, float pitch) {
+    glm_vec3_copy(position, cam->Position);
+    cam->Yaw = yaw;
+    cam->Pitch = pitch;
+    camera_update_vectors(cam);
+}
+
 void camera_get_view_matrix(Camera* cam, mat4 view) {
     vec3 target;
     glm_vec3_add(cam->Position, cam->Front, target);
@@ -0,0 +1,46 @@
+#include "fixedstep.h"
+#include <math.h>
+
+/*
+
+   the fixedstep module should only turn variable frame times into a whole
+   number of fixed updates and say how far the frame is between the last two
+   it should NOT run the updates or know what they simulate, main does
+
+   OWNS: the accumulator
+
+   input: frame times
+   output: update counts, interpolation factors
+
+*/
+
+void fixedstep_init(FixedStep* sim, float hz, int maxSteps) {
+    sim->step = 1.0 / (double)hz;
+    sim->maxSteps = maxSteps > 0 ? maxSteps : 1;
+    sim->accumulator = 0.0;
+    sim->steps = 0;
+    sim->dropped = 0.0;
+}
+
+int fixedstep_advance(FixedStep* sim, double frameTime) {
+    if (frameTime > 0.0) sim->accumulator += frameTime;
+
+    int steps = (int)(sim->accumulator / sim->step);
+    if (steps > sim->maxSteps) {
+        // a hitch: run what the cap allows and let the rest go, catching up
+        // all of it would make the next frame slower still
+        double kept = fmod(sim->accumulator, sim->step);
+        sim->dropped += sim->accumulator - kept - sim->maxSteps * sim->step;
+        sim->accumulator = kept + sim->maxSteps * sim->step;
+        steps = sim->maxSteps;
+    }
+
+    sim->accumulator -= steps * sim->step;
+    sim->steps += (uint64_t)steps;
+    return steps;
+}
+
+float fixedstep_alpha(const FixedStep* sim) {
+    float alpha = (float)(sim->accumulator / sim->step);
+    return alpha < 1.0f ? alpha : 1.0f;
+}
@@ -0,0 +1,578 @@
+#include "framegraph.h"
+#include "gldebug.h"
+#include "gputimer.h"
+#include <stdio.h>
+#include <string.h>
+
+/*
+
+   the frame graph should only decide which passes run, in what order, and on
+   which GL targets. the passes themselves decide what to draw
+
+   every frame the passes are declared again with the resources they read and
+   write. compiling drops passes nobody consumes, orders the rest so passes
+   sharing a framebuffer run back to back, and lets transient targets whose
+   lifetimes do not overlap share one GL texture
+
+   OWNS: transient render targets, transient buffers and their framebuffers
+
+   input: pass declarations (reads, writes, execute callback)
+   output: passes executed with their framebuffer bound
+
+*/
+
+static bool is_depth_format(GLenum format) {
+    return format == GL_DEPTH_COMPONENT16 || format == GL_DEPTH_COMPONENT24 ||
+           format == GL_DEPTH_COMPONENT32 || format == GL_DEPTH_COMPONENT32F ||
+           format == GL_DEPTH24_STENCIL8 || format == GL_DEPTH32F_STENCIL8;
+}
+
+static bool has_stencil(GLenum format) {
+    return format == GL_DEPTH24_STENCIL8 || format == GL_DEPTH32F_STENCIL8;
+}
+
+static size_t bytes_per_pixel(GLenum format) {
+    switch (format) {
+    case GL_R8: return 1;
+    case GL_R16F: case GL_RG8: case GL_DEPTH_COMPONENT16: return 2;
+    case GL_RGBA16F: case GL_RG32F: case GL_DEPTH32F_STENCIL8: return 8;
+    case GL_RGBA32F: return 16;
+    default: return 4;
+    }
+}
+
+static size_t resource_bytes(const FgResource* r) {
+    if (r->type == FG_RESOURCE_BUFFER) return (size_t)r->size;
+    return (size_t)r->width * (size_t)r->height * bytes_per_pixel(r->format);
+}
+
+static size_t physical_bytes(const FgPhysical* p) {
+    if (p->type == FG_RESOURCE_BUFFER) return (size_t)p->size;
+    return (size_t)p->width * (size_t)p->height * bytes_per_pixel(p->format);
+}
+
+static const char* format_name(GLenum format) {
+    switch (format) {
+    case GL_R8: return "R8";
+    case GL_RG8: return "RG8";
+    case GL_RGBA8: return "RGBA8";
+    case GL_R16F: return "R16F";
+    case GL_RGBA16F: return "RGBA16F";
+    case GL_RG32F: return "RG32F";
+    case GL_RGBA32F: return "RGBA32F";
+    case GL_R11F_G11F_B10F: return "R11G11B10F";
+    case GL_DEPTH_COMPONENT16: return "D16";
+    case GL_DEPTH_COMPONENT24: return "D24";
+    case GL_DEPTH_COMPONENT32F: return "D32F";
+    case GL_DEPTH24_STENCIL8: return "D24S8";
+    case GL_DEPTH32F_STENCIL8: return "D32FS8";
+    default: return "?";
+    }
+}
+
+static bool pass_uses(const FgPass* p, FgResourceId res, bool writes) {
+    const FgResourceId* list = writes ? p->writes : p->reads;
+    int count = writes ? p->writeCount : p->readCount;
+    for (int i = 0; i < count; i++)
+        if (list[i] == res) return true;
+    return false;
+}
+
+// b has to run after a (a declared first): RAW, WAW and WAR hazards
+static bool depends_on(const FgPass* b, const FgPass* a) {
+    for (int i = 0; i < a->writeCount; i++)
+        if (pass_uses(b, a->writes[i], false) || pass_uses(b, a->writes[i], true))
+            return true;
+    for (int i = 0; i < a->readCount; i++)
+        if (pass_uses(b, a->reads[i], true))
+            return true;
+    return false;
+}
+
+static bool same_targets(const FrameGraph* fg, const FgPass* a, const FgPass* b) {
+    int ia = 0, ib = 0;
+    for (;;) {
+        while (ia < a->writeCount && fg->resources[a->writes[ia]].type != FG_RESOURCE_TEXTURE) ia++;
+        while (ib < b->writeCount && fg->resources[b->writes[ib]].type != FG_RESOURCE_TEXTURE) ib++;
+        if (ia == a->writeCount || ib == b->writeCount)
+            return ia == a->writeCount && ib == b->writeCount;
+        if (a->writes[ia] != b->writes[ib]) return false;
+        ia++;
+        ib++;
+    }
+}
+
+static void release_physical(FrameGraph* fg, int slot) {
+    FgPhysical* p = &fg->pool[slot];
+
+    // framebuffers that attach this texture go with it
+    for (int t = 0; t < fg->targetCount; t++) {
+        FgTarget* target = &fg->targets[t];
+        bool uses = p->type == FG_RESOURCE_TEXTURE && target->depth == p->id;
+        for (int c = 0; c < target->colorCount; c++)
+            if (p->type == FG_RESOURCE_TEXTURE && target->colors[c] == p->id) uses = true;
+        if (uses) {
+            glDeleteFramebuffers(1, &target->fbo);
+            fg->targets[t--] = fg->targets[--fg->targetCount];
+        }
+    }
+
+    if (p->type == FG_RESOURCE_TEXTURE)
+        glDeleteTextures(1, &p->id);
+    else
+        glDeleteBuffers(1, &p->id);
+
+    fg->pool[slot] = fg->pool[--fg->poolCount];
+}
+
+static int create_physical(FrameGraph* fg, const FgResource* r) {
+    if (fg->poolCount == FRAMEGRAPH_MAX_PHYSICAL) {
+        fprintf(stderr, "Frame graph: out of physical resources for %s\n", r->name);
+        return -1;
+    }
+
+    FgPhysical* p = &fg->pool[fg->poolCount];
+    memset(p, 0, sizeof(*p));
+    p->type = r->type;
+    p->width = r->width;
+    p->height = r->height;
+    p->format = r->format;
+    p->size = r->size;
+
+    if (r->type == FG_RESOURCE_TEXTURE) {
+        GLenum format = GL_RGBA, type = GL_UNSIGNED_BYTE;
+        if (has_stencil(r->format)) {
+            format = GL_DEPTH_STENCIL;
+            type = r->format == GL_DEPTH32F_STENCIL8 ? GL_FLOAT_32_UNSIGNED_INT_24_8_REV
+                                                     : GL_UNSIGNED_INT_24_8;
+        } else if (is_depth_format(r->format)) {
+            format = GL_DEPTH_COMPONENT;
+            type = GL_FLOAT;
+        }
+
+        glGenTextures(1, &p->id);
+        glBindTexture(GL_TEXTURE_2D, p->id);
+        glTexImage2D(GL_TEXTURE_2D, 0, r->format, r->width, r->height, 0, format, type, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        gldebug_label(GL_TEXTURE, p->id, r->name); // aliased later, named after its first user
+    } else {
+        glGenBuffers(1, &p->id);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, p->id);
+        glBufferData(GL_COPY_WRITE_BUFFER, r->size, NULL, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        gldebug_label(GL_BUFFER, p->id, r->name);
+    }
+
+    return fg->poolCount++;
+}
+
+static bool physical_fits(const FgPhysical* p, const FgResource* r) {
+    if (p->type != r->type) return false;
+    if (r->type == FG_RESOURCE_BUFFER) return p->size >= r->size;
+    return p->width == r->width && p->height == r->height && p->format == r->format;
+}
+
+static GLuint find_or_create_target(FrameGraph* fg, const GLuint* colors, int colorCount,
+                                    GLuint depth, GLenum depthFormat) {
+    for (int t = 0; t < fg->targetCount; t++) {
+        FgTarget* target = &fg->targets[t];
+        if (target->colorCount != colorCount || target->depth != depth) continue;
+        if (memcmp(target->colors, colors, sizeof(GLuint) * colorCount) != 0) continue;
+        target->lastFrame = fg->frame;
+        return target->fbo;
+    }
+
+    if (fg->targetCount == FRAMEGRAPH_MAX_TARGETS) {
+        fprintf(stderr, "Frame graph: out of framebuffers\n");
+        return 0;
+    }
+
+    FgTarget* target = &fg->targets[fg->targetCount++];
+    memset(target, 0, sizeof(*target));
+    memcpy(target->colors, colors, sizeof(GLuint) * colorCount);
+    target->colorCount = colorCount;
+    target->depth = depth;
+    target->lastFrame = fg->frame;
+
+    GLenum drawBuffers[FRAMEGRAPH_MAX_COLOR_TARGETS];
+    glGenFramebuffers(1, &target->fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, target->fbo);
+    for (int c = 0; c < colorCount; c++) {
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + c, GL_TEXTURE_2D, colors[c], 0);
+        drawBuffers[c] = GL_COLOR_ATTACHMENT0 + c;
+    }
+    if (depth) {
+        GLenum attachment = has_stencil(depthFormat) ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT;
+        glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, depth, 0);
+    }
+    if (colorCount > 0) {
+        glDrawBuffers(colorCount, drawBuffers);
+    } else {
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+    }
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        fprintf(stderr, "Frame graph: incomplete framebuffer\n");
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    return target->fbo;
+}
+
+// --------------------------------------------------
+// Declaration
+// --------------------------------------------------
+
+void framegraph_init(FrameGraph* fg) {
+    memset(fg, 0, sizeof(*fg));
+}
+
+void framegraph_begin(FrameGraph* fg) {
+    fg->passCount = 0;
+    fg->resourceCount = 0;
+    fg->orderCount = 0;
+    fg->frame++;
+}
+
+static FgResourceId add_resource(FrameGraph* fg, const char* name, FgResourceType type) {
+    if (fg->resourceCount == FRAMEGRAPH_MAX_RESOURCES) {
+        fprintf(stderr, "Frame graph: too many resources (%s)\n", name);
+        return FG_NONE;
+    }
+    FgResource* r = &fg->resources[fg->resourceCount];
+    memset(r, 0, sizeof(*r));
+    r->name = name;
+    r->type = type;
+    r->firstUse = r->lastUse = -1;
+    r->physical = -1;
+    return fg->resourceCount++;
+}
+
+FgResourceId framegraph_import_target(FrameGraph* fg, const char* name, GLuint fbo, int width, int height) {
+    FgResourceId id = add_resource(fg, name, FG_RESOURCE_TEXTURE);
+    if (id == FG_NONE) return id;
+    FgResource* r = &fg->resources[id];
+    r->imported = true;
+    r->importedFbo = fbo;
+    r->width = width;
+    r->height = height;
+    return id;
+}
+
+FgResourceId framegraph_create_texture(FrameGraph* fg, const char* name, int width, int height, GLenum format) {
+    FgResourceId id = add_resource(fg, name, FG_RESOURCE_TEXTURE);
+    if (id == FG_NONE) return id;
+    FgResource* r = &fg->resources[id];
+    r->width = width;
+    r->height = height;
+    r->format = format;
+    return id;
+}
+
+FgResourceId framegraph_create_buffer(FrameGraph* fg, const char* name, GLsizeiptr size) {
+    FgResourceId id = add_resource(fg, name, FG_RESOURCE_BUFFER);
+    if (id == FG_NONE) return id;
+    fg->resources[id].size = size;
+    return id;
+}
+
+int framegraph_add_pass(FrameGraph* fg, const char* name, FramegraphExecuteFn execute, void* user) {
+    if (fg->passCount == FRAMEGRAPH_MAX_PASSES) {
+        fprintf(stderr, "Frame graph: too many passes (%s)\n", name);
+        return -1;
+    }
+    FgPass* p = &fg->passes[fg->passCount];
+    memset(p, 0, sizeof(*p));
+    p->name = name;
+    p->execute = execute;
+    p->user = user;
+    return fg->passCount++;
+}
+
+void framegraph_read(FrameGraph* fg, int pass, FgResourceId res) {
+    if (pass < 0 || res == FG_NONE) return;
+    FgPass* p = &fg->passes[pass];
+    if (p->readCount < FRAMEGRAPH_MAX_PASS_IO) p->reads[p->readCount++] = res;
+}
+
+void framegraph_write(FrameGraph* fg, int pass, FgResourceId res) {
+    if (pass < 0 || res == FG_NONE) return;
+    FgPass* p = &fg->passes[pass];
+    if (p->writeCount < FRAMEGRAPH_MAX_PASS_IO) p->writes[p->writeCount++] = res;
+}
+
+void framegraph_side_effect(FrameGraph* fg, int pass) {
+    if (pass >= 0) fg->passes[pass].sideEffect = true;
+}
+
+// --------------------------------------------------
+// Compilation
+// --------------------------------------------------
+
+static void cull_passes(FrameGraph* fg) {
+    for (int i = 0; i < fg->passCount; i++) {
+        FgPass* p = &fg->passes[i];
+        p->culled = !p->sideEffect;
+        for (int w = 0; w < p->writeCount; w++)
+            if (fg->resources[p->writes[w]].imported) p->culled = false;
+    }
+
+    // walk backwards: a live pass keeps alive every earlier writer of what it touches
+    for (int i = fg->passCount - 1; i >= 0; i--) {
+        if (fg->passes[i].culled) continue;
+        for (int j = 0; j < i; j++) {
+            FgPass* writer = &fg->passes[j];
+            if (!writer->culled) continue;
+            for (int w = 0; w < writer->writeCount; w++) {
+                FgResourceId res = writer->writes[w];
+                if (pass_uses(&fg->passes[i], res, false) || pass_uses(&fg->passes[i], res, true)) {
+                    writer->culled = false;
+                    i = fg->passCount; // restart, the revived pass has inputs of its own
+                    break;
+                }
+            }
+            if (i == fg->passCount) break;
+        }
+    }
+}
+
+static void order_passes(FrameGraph* fg) {
+    bool scheduled[FRAMEGRAPH_MAX_PASSES] = { false };
+    int live = 0;
+    for (int i = 0; i < fg->passCount; i++)
+        if (!fg->passes[i].culled) live++;
+
+    const FgPass* current = NULL;
+    fg->orderCount = 0;
+    while (fg->orderCount < live) {
+        int pick = -1;
+        for (int i = 0; i < fg->passCount; i++) {
+            const FgPass* p = &fg->passes[i];
+            if (p->culled || scheduled[i]) continue;
+
+            bool ready = true;
+            for (int j = 0; j < i && ready; j++)
+                if (!fg->passes[j].culled && !scheduled[j] && depends_on(p, &fg->passes[j]))
+                    ready = false;
+            if (!ready) continue;
+
+            // first ready pass by declaration, unless one keeps the bound framebuffer
+            if (pick < 0) pick = i;
+            if (current && same_targets(fg, p, current)) {
+                pick = i;
+                break;
+            }
+        }
+        scheduled[pick] = true;
+        fg->order[fg->orderCount++] = pick;
+        current = &fg->passes[pick];
+    }
+}
+
+static void compute_lifetimes(FrameGraph* fg) {
+    for (int r = 0; r < fg->resourceCount; r++) {
+        fg->resources[r].firstUse = fg->resources[r].lastUse = -1;
+        fg->resources[r].physical = -1;
+    }
+
+    for (int o = 0; o < fg->orderCount; o++) {
+        const FgPass* p = &fg->passes[fg->order[o]];
+        for (int k = 0; k < p->readCount + p->writeCount; k++) {
+            FgResourceId id = k < p->readCount ? p->reads[k] : p->writes[k - p->readCount];
+            FgResource* r = &fg->resources[id];
+            if (r->firstUse < 0) r->firstUse = o;
+            r->lastUse = o;
+        }
+    }
+}
+
+static void alias_resources(FrameGraph* fg) {
+    for (int i = 0; i < fg->poolCount; i++)
+        fg->pool[i].busyUntil = -1;
+
+    fg->transientBytes = 0;
+    fg->physicalBytes = 0;
+
+    // hand out slots in order of first use so freed slots get picked up
+    for (int o = 0; o < fg->orderCount; o++) {
+        for (int id = 0; id < fg->resourceCount; id++) {
+            FgResource* r = &fg->resources[id];
+            if (r->imported || r->firstUse != o) continue;
+
+            fg->transientBytes += resource_bytes(r);
+
+            int slot = -1;
+            for (int i = 0; i < fg->poolCount; i++) {
+                if (fg->pool[i].busyUntil < r->firstUse && physical_fits(&fg->pool[i], r)) {
+                    slot = i;
+                    break;
+                }
+            }
+            if (slot < 0) slot = create_physical(fg, r);
+            if (slot < 0) continue;
+
+            if (fg->pool[slot].lastFrame != fg->frame)
+                fg->physicalBytes += physical_bytes(&fg->pool[slot]);
+            fg->pool[slot].busyUntil = r->lastUse;
+            fg->pool[slot].lastFrame = fg->frame;
+            r->physical = slot;
+        }
+    }
+}
+
+static void trim_pool(FrameGraph* fg) {
+    for (int i = 0; i < fg->poolCount; i++) {
+        if (fg->frame - fg->pool[i].lastFrame > FRAMEGRAPH_POOL_TTL) {
+            release_physical(fg, i);
+            i = -1; // slots moved, rescan
+        }
+    }
+}
+
+static bool build_targets(FrameGraph* fg) {
+    for (int o = 0; o < fg->orderCount; o++) {
+        FgPass* p = &fg->passes[fg->order[o]];
+        GLuint colors[FRAMEGRAPH_MAX_COLOR_TARGETS];
+        int colorCount = 0;
+        GLuint depth = 0;
+        GLenum depthFormat = GL_NONE;
+        const FgResource* imported = NULL;
+
+        p->hasTarget = false;
+        for (int w = 0; w < p->writeCount; w++) {
+            const FgResource* r = &fg->resources[p->writes[w]];
+            if (r->type != FG_RESOURCE_TEXTURE) continue;
+
+            p->hasTarget = true;
+            p->width = r->width;
+            p->height = r->height;
+
+            if (r->imported) {
+                imported = r;
+            } else if (r->physical < 0) {
+                return false;
+            } else if (is_depth_format(r->format)) {
+                depth = fg->pool[r->physical].id;
+                depthFormat = r->format;
+            } else if (colorCount < FRAMEGRAPH_MAX_COLOR_TARGETS) {
+                colors[colorCount++] = fg->pool[r->physical].id;
+            }
+        }
+
+        if (!p->hasTarget) continue;
+
+        if (imported) {
+            if (colorCount > 0 || depth) {
+                fprintf(stderr, "Frame graph: pass %s mixes %s with transient targets\n",
+                        p->name, imported->name);
+                return false;
+            }
+            p->fbo = imported->importedFbo;
+        } else {
+            p->fbo = find_or_create_target(fg, colors, colorCount, depth, depthFormat);
+        }
+    }
+    return true;
+}
+
+bool framegraph_compile(FrameGraph* fg) {
+    cull_passes(fg);
+    order_passes(fg);
+    compute_lifetimes(fg);
+    trim_pool(fg); // before aliasing, releasing a slot moves the others
+    alias_resources(fg);
+    return build_targets(fg);
+}
+
+// --------------------------------------------------
+// Execution
+// --------------------------------------------------
+
+void framegraph_execute(FrameGraph* fg) {
+    GLint bound = 0;
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &bound);
+
+    fg->fboSwitches = 0;
+    for (int o = 0; o < fg->orderCount; o++) {
+        FgPass* p = &fg->passes[fg->order[o]];
+        if (p->hasTarget) {
+            if ((GLuint)bound != p->fbo) {
+                glBindFramebuffer(GL_FRAMEBUFFER, p->fbo);
+                bound = (GLint)p->fbo;
+                fg->fboSwitches++;
+            }
+            glViewport(0, 0, p->width, p->height);
+        }
+        // every pass is a GPU timer zone and a debug group, each a no-op unless enabled
+        int zone = gputimer_begin(p->name);
+        gldebug_push_group(p->name);
+        if (p->execute) p->execute(p->user);
+        gldebug_pop_group();
+        gputimer_end(zone);
+    }
+}
+
+GLuint framegraph_texture(const FrameGraph* fg, FgResourceId res) {
+    if (res == FG_NONE) return 0;
+    const FgResource* r = &fg->resources[res];
+    if (r->type != FG_RESOURCE_TEXTURE || r->physical < 0) return 0;
+    return fg->pool[r->physical].id;
+}
+
+GLuint framegraph_buffer(const FrameGraph* fg, FgResourceId res) {
+    if (res == FG_NONE) return 0;
+    const FgResource* r = &fg->resources[res];
+    if (r->type != FG_RESOURCE_BUFFER || r->physical < 0) return 0;
+    return fg->pool[r->physical].id;
+}
+
+void framegraph_dump(const FrameGraph* fg, FILE* out) {
+    int culled = fg->passCount - fg->orderCount;
+    fprintf(out, "framegraph frame %d: %d passes, %d culled, %d fbo switches\n",
+            fg->frame, fg->orderCount, culled, fg->fboSwitches);
+
+    for (int o = 0; o < fg->orderCount; o++) {
+        const FgPass* p = &fg->passes[fg->order[o]];
+        fprintf(out, "  [%d] %-16s", o, p->name);
+        if (p->hasTarget) fprintf(out, " fbo %-3u", p->fbo);
+        else fprintf(out, " %-7s", "");
+        for (int r = 0; r < p->readCount; r++)
+            fprintf(out, " <%s", fg->resources[p->reads[r]].name);
+        for (int w = 0; w < p->writeCount; w++)
+            fprintf(out, " >%s", fg->resources[p->writes[w]].name);
+        fputc('\n', out);
+    }
+    for (int i = 0; i < fg->passCount; i++)
+        if (fg->passes[i].culled) fprintf(out, "  [-] %-16s culled\n", fg->passes[i].name);
+
+    for (int id = 0; id < fg->resourceCount; id++) {
+        const FgResource* r = &fg->resources[id];
+        fprintf(out, "  %-16s ", r->name);
+        if (r->imported)
+            fprintf(out, "imported %dx%d", r->width, r->height);
+        else if (r->type == FG_RESOURCE_TEXTURE)
+            fprintf(out, "%-8s %dx%d", format_name(r->format), r->width, r->height);
+        else
+            fprintf(out, "buffer   %ld bytes", (long)r->size);
+
+        if (r->firstUse < 0) fprintf(out, "  unused\n");
+        else if (r->imported) fprintf(out, "  passes %d..%d\n", r->firstUse, r->lastUse);
+        else fprintf(out, "  passes %d..%d  slot %d\n", r->firstUse, r->lastUse, r->physical);
+    }
+
+    fprintf(out, "  memory: %.2f MB transient, %.2f MB allocated after aliasing, %d physical\n",
+            fg->transientBytes / (1024.0 * 1024.0), fg->physicalBytes / (1024.0 * 1024.0),
+            fg->poolCount);
+}
+
+void framegraph_destroy(FrameGraph* fg) {
+    while (fg->poolCount > 0)
+        release_physical(fg, fg->poolCount - 1);
+    for (int t = 0; t < fg->targetCount; t++)
+        glDeleteFramebuffers(1, &fg->targets[t].fbo);
+    fg->targetCount = 0;
+}
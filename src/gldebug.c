@@ -0,0 +1,244 @@
+#define _POSIX_C_SOURCE 200809L // strdup
+#include <glad/glad.h>
+#include "gldebug.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+
+   the gldebug module should only collect what the driver says about our GL use
+   it should NOT change how anything is drawn
+
+   the callback runs synchronously, inside the GL call that caused the
+   message, so the debug group stack at that moment says which pass, mesh,
+   material or shader was being drawn. every object we create carries the path
+   of its asset as a label, so a performance warning names the file behind it
+
+   OWNS: the debug callback, message counts, object labels, group stack
+
+   input: driver messages, labels and groups from the other modules
+   output: one report line per new message, a summary in gldebug_dump
+
+*/
+
+typedef struct {
+    GLenum source, type, severity;
+    GLuint id;
+    uint32_t hash;               // of the text, drivers reuse ids for different messages
+    int count;
+    char text[256];
+    char where[256];             // debug groups open when it was first seen
+} DebugMessage;
+
+typedef struct {
+    GLenum type;
+    GLuint object;
+    char* label;
+} ObjectLabel;
+
+static bool enabled = false;
+
+static DebugMessage messages[GLDEBUG_MAX_MESSAGES];
+static int messageCount = 0;
+static int untracked = 0;        // messages beyond GLDEBUG_MAX_MESSAGES
+
+static ObjectLabel labels[GLDEBUG_MAX_LABELS];
+static int labelCount = 0;
+
+static const char* groups[GLDEBUG_MAX_DEPTH];
+static int groupDepth = 0;
+static int hiddenGroups = 0;     // pushes past GLDEBUG_MAX_DEPTH
+
+static const char* source_name(GLenum source) {
+    switch (source) {
+    case GL_DEBUG_SOURCE_API: return "api";
+    case GL_DEBUG_SOURCE_WINDOW_SYSTEM: return "window";
+    case GL_DEBUG_SOURCE_SHADER_COMPILER: return "shader compiler";
+    case GL_DEBUG_SOURCE_THIRD_PARTY: return "third party";
+    case GL_DEBUG_SOURCE_APPLICATION: return "application";
+    default: return "other";
+    }
+}
+
+static const char* type_name(GLenum type) {
+    switch (type) {
+    case GL_DEBUG_TYPE_ERROR: return "error";
+    case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR: return "deprecated";
+    case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR: return "undefined";
+    case GL_DEBUG_TYPE_PORTABILITY: return "portability";
+    case GL_DEBUG_TYPE_PERFORMANCE: return "performance";
+    case GL_DEBUG_TYPE_MARKER: return "marker";
+    case GL_DEBUG_TYPE_PUSH_GROUP: return "push group";
+    case GL_DEBUG_TYPE_POP_GROUP: return "pop group";
+    default: return "other";
+    }
+}
+
+static const char* severity_name(GLenum severity) {
+    switch (severity) {
+    case GL_DEBUG_SEVERITY_HIGH: return "high";
+    case GL_DEBUG_SEVERITY_MEDIUM: return "medium";
+    case GL_DEBUG_SEVERITY_LOW: return "low";
+    default: return "note";
+    }
+}
+
+// FNV-1a
+static uint32_t hash_text(const char* s, GLsizei length) {
+    uint32_t h = 2166136261u;
+    for (GLsizei i = 0; i < length && s[i]; i++) {
+        h ^= (unsigned char)s[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static void describe_groups(char* out, size_t size) {
+    out[0] = '\0';
+    size_t used = 0;
+    for (int i = 0; i < groupDepth && used < size; i++)
+        used += snprintf(out + used, size - used, "%s%s", i ? " > " : "", groups[i]);
+}
+
+static void APIENTRY on_message(GLenum source, GLenum type, GLuint id, GLenum severity,
+                                GLsizei length, const GLchar* text, const void* user) {
+    (void)user;
+
+    // our own push/pop echoes
+    if (type == GL_DEBUG_TYPE_PUSH_GROUP || type == GL_DEBUG_TYPE_POP_GROUP) return;
+
+    if (length < 0) length = (GLsizei)strlen(text);
+    uint32_t hash = hash_text(text, length);
+
+    for (int i = 0; i < messageCount; i++) {
+        DebugMessage* m = &messages[i];
+        if (m->id == id && m->hash == hash && m->source == source && m->type == type) {
+            m->count++;
+            return;
+        }
+    }
+
+    if (messageCount == GLDEBUG_MAX_MESSAGES) {
+        untracked++;
+        return;
+    }
+
+    DebugMessage* m = &messages[messageCount++];
+    m->source = source;
+    m->type = type;
+    m->severity = severity;
+    m->id = id;
+    m->hash = hash;
+    m->count = 1;
+    snprintf(m->text, sizeof(m->text), "%.*s", (int)length, text);
+    describe_groups(m->where, sizeof(m->where));
+
+    // notifications are mostly buffer placement chatter, only the summary lists them
+    if (severity == GL_DEBUG_SEVERITY_NOTIFICATION) return;
+
+    fprintf(stderr, "GL %s %s/%s #%u: %s\n", severity_name(severity), source_name(source),
+            type_name(type), id, m->text);
+    if (m->where[0]) fprintf(stderr, "    in %s\n", m->where);
+}
+
+bool gldebug_init(void) {
+    GLint flags = 0;
+    glGetIntegerv(GL_CONTEXT_FLAGS, &flags);
+    if (!GLAD_GL_KHR_debug || !(flags & GL_CONTEXT_FLAG_DEBUG_BIT)) {
+        fprintf(stderr, "No debug context, GL debug output is off\n");
+        return false;
+    }
+
+    glEnable(GL_DEBUG_OUTPUT);
+    // report inside the offending call, so the group stack is still the right one
+    glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+    glDebugMessageCallback(on_message, NULL);
+    glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE, 0, NULL, GL_TRUE);
+
+    messageCount = 0;
+    untracked = 0;
+    groupDepth = 0;
+    hiddenGroups = 0;
+    enabled = true;
+    return true;
+}
+
+bool gldebug_enabled(void) {
+    return enabled;
+}
+
+void gldebug_label(unsigned int type, unsigned int object, const char* label) {
+    if (!enabled || !object || !label) return;
+
+    glObjectLabel(type, object, -1, label);
+
+    // names are reused after a delete, the newest label wins
+    for (int i = 0; i < labelCount; i++) {
+        if (labels[i].type == type && labels[i].object == object) {
+            free(labels[i].label);
+            labels[i].label = strdup(label);
+            return;
+        }
+    }
+    if (labelCount == GLDEBUG_MAX_LABELS) return;
+    labels[labelCount].type = type;
+    labels[labelCount].object = object;
+    labels[labelCount].label = strdup(label);
+    labelCount++;
+}
+
+const char* gldebug_object_label(unsigned int type, unsigned int object) {
+    for (int i = 0; i < labelCount; i++)
+        if (labels[i].type == type && labels[i].object == object) return labels[i].label;
+    return NULL;
+}
+
+void gldebug_push_group(const char* name) {
+    if (!enabled) return;
+
+    glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, name);
+    if (groupDepth < GLDEBUG_MAX_DEPTH)
+        groups[groupDepth++] = name;
+    else
+        hiddenGroups++;
+}
+
+void gldebug_pop_group(void) {
+    if (!enabled) return;
+
+    glPopDebugGroup();
+    if (hiddenGroups > 0)
+        hiddenGroups--;
+    else if (groupDepth > 0)
+        groupDepth--;
+}
+
+static int compare_count(const void* a, const void* b) {
+    return ((const DebugMessage*)b)->count - ((const DebugMessage*)a)->count;
+}
+
+void gldebug_dump(FILE* out) {
+    if (!enabled) return;
+
+    static DebugMessage sorted[GLDEBUG_MAX_MESSAGES];
+    memcpy(sorted, messages, sizeof(DebugMessage) * messageCount);
+    qsort(sorted, messageCount, sizeof(DebugMessage), compare_count);
+
+    int perType[8] = { 0 };
+    for (int i = 0; i < messageCount; i++) {
+        GLenum type = sorted[i].type;
+        int slot = type >= GL_DEBUG_TYPE_ERROR && type <= GL_DEBUG_TYPE_OTHER ? (int)(type - GL_DEBUG_TYPE_ERROR) : 7;
+        perType[slot] += sorted[i].count;
+    }
+
+    fprintf(out, "gl debug: %d distinct messages (%d more not tracked)\n", messageCount, untracked);
+    fprintf(out, "  errors %d  undefined %d  performance %d  portability %d  deprecated %d  other %d\n",
+            perType[0], perType[2], perType[4], perType[3], perType[1], perType[5] + perType[7]);
+    for (int i = 0; i < messageCount; i++) {
+        const DebugMessage* m = &sorted[i];
+        fprintf(out, "  %6dx %-6s %s/%s #%u: %s\n", m->count, severity_name(m->severity),
+                source_name(m->source), type_name(m->type), m->id, m->text);
+        if (m->where[0]) fprintf(out, "          in %s\n", m->where);
+    }
+}
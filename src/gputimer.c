@@ -0,0 +1,192 @@
+#include <glad/glad.h>
+#include "gputimer.h"
+#include <stdlib.h>
+#include <string.h>
+
+/*
+
+   the gputimer module should only measure how long the GPU spends on zones
+   it should NOT decide what a zone is, passes and the renderer name them
+
+   each zone writes two GL_TIMESTAMP queries (timestamps nest, TIME_ELAPSED
+   does not). queries live in a ring of GPU_TIMER_FRAMES frames and a frame is
+   only read when it comes around again, by then the GPU has long finished it
+   and reading never stalls. if it has not, the frame is dropped instead
+
+   OWNS: timestamp query objects, per-zone rolling statistics
+
+   input: zone begin/end markers from the frame
+   output: min/avg/p95/max GPU milliseconds per zone name
+
+*/
+
+typedef struct {
+    const char* name;
+    GLuint queries[2];           // begin, end timestamp
+} GpuZone;
+
+typedef struct {
+    GpuZone zones[GPU_TIMER_MAX_ZONES];
+    int zoneCount;
+    GLuint lastQuery;            // issued last, so it completes last
+    bool submitted;              // holds queries not read back yet
+} GpuFrame;
+
+static GpuFrame frames[GPU_TIMER_FRAMES];
+static GLuint queryPool[GPU_TIMER_FRAMES][GPU_TIMER_MAX_ZONES][2];
+static int current = 0;
+static int frameZone = -1;
+static bool initialized = false;
+static int droppedFrames = 0;
+
+static GpuTimerStats stats[GPU_TIMER_MAX_NAMES];
+static int statsCount = 0;
+
+bool gputimer_init(void) {
+    // timestamp queries are core in 3.3, but a driver may give them no bits
+    GLint bits = 0;
+    glGetQueryiv(GL_TIMESTAMP, GL_QUERY_COUNTER_BITS, &bits);
+    if (bits == 0) return false;
+
+    glGenQueries(GPU_TIMER_FRAMES * GPU_TIMER_MAX_ZONES * 2, &queryPool[0][0][0]);
+    memset(frames, 0, sizeof(frames));
+    memset(stats, 0, sizeof(stats));
+    statsCount = 0;
+    current = 0;
+    droppedFrames = 0;
+    initialized = true;
+    return true;
+}
+
+void gputimer_shutdown(void) {
+    if (!initialized) return;
+    glDeleteQueries(GPU_TIMER_FRAMES * GPU_TIMER_MAX_ZONES * 2, &queryPool[0][0][0]);
+    initialized = false;
+}
+
+static GpuTimerStats* find_stats(const char* name) {
+    for (int i = 0; i < statsCount; i++)
+        if (strcmp(stats[i].name, name) == 0) return &stats[i];
+    if (statsCount == GPU_TIMER_MAX_NAMES) return NULL;
+
+    GpuTimerStats* s = &stats[statsCount++];
+    memset(s, 0, sizeof(*s));
+    s->name = name;
+    return s;
+}
+
+static int compare_float(const void* a, const void* b) {
+    float fa = *(const float*)a, fb = *(const float*)b;
+    return fa < fb ? -1 : (fa > fb);
+}
+
+static void add_sample(GpuTimerStats* s, float ms) {
+    s->last = ms;
+    s->history[s->head] = ms;
+    s->head = (s->head + 1) % GPU_TIMER_HISTORY;
+    if (s->samples < GPU_TIMER_HISTORY) s->samples++;
+
+    float sorted[GPU_TIMER_HISTORY];
+    memcpy(sorted, s->history, sizeof(float) * s->samples);
+    qsort(sorted, s->samples, sizeof(float), compare_float);
+
+    float sum = 0.0f;
+    for (int i = 0; i < s->samples; i++) sum += sorted[i];
+    s->min = sorted[0];
+    s->max = sorted[s->samples - 1];
+    s->avg = sum / s->samples;
+    s->p95 = sorted[(s->samples * 95) / 100];
+}
+
+static void read_back(GpuFrame* frame) {
+    if (!frame->submitted) return;
+    frame->submitted = false;
+    if (frame->zoneCount == 0) return;
+
+    // queries complete in submission order
+    GLint available = 0;
+    glGetQueryObjectiv(frame->lastQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available) {
+        droppedFrames++;
+        return;
+    }
+
+    for (int z = 0; z < frame->zoneCount; z++) {
+        GpuZone* zone = &frame->zones[z];
+        GLuint64 begin = 0, end = 0;
+        glGetQueryObjectui64v(zone->queries[0], GL_QUERY_RESULT, &begin);
+        glGetQueryObjectui64v(zone->queries[1], GL_QUERY_RESULT, &end);
+
+        GpuTimerStats* s = find_stats(zone->name);
+        if (s && end >= begin) add_sample(s, (float)((end - begin) / 1.0e6));
+    }
+}
+
+void gputimer_begin_frame(void) {
+    if (!initialized) return;
+
+    GpuFrame* frame = &frames[current];
+    read_back(frame);
+    frame->zoneCount = 0;
+
+    frameZone = gputimer_begin("frame");
+}
+
+void gputimer_end_frame(void) {
+    if (!initialized) return;
+
+    gputimer_end(frameZone);
+    frameZone = -1;
+
+    frames[current].submitted = true;
+    current = (current + 1) % GPU_TIMER_FRAMES;
+}
+
+int gputimer_begin(const char* name) {
+    if (!initialized) return -1;
+    GpuFrame* frame = &frames[current];
+    if (frame->zoneCount == GPU_TIMER_MAX_ZONES) return -1;
+
+    int index = frame->zoneCount++;
+    GpuZone* zone = &frame->zones[index];
+    zone->name = name;
+    zone->queries[0] = queryPool[current][index][0];
+    zone->queries[1] = queryPool[current][index][1];
+    glQueryCounter(zone->queries[0], GL_TIMESTAMP);
+    frame->lastQuery = zone->queries[0];
+    return index;
+}
+
+void gputimer_end(int zone) {
+    if (!initialized || zone < 0) return;
+    GpuFrame* frame = &frames[current];
+    glQueryCounter(frame->zones[zone].queries[1], GL_TIMESTAMP);
+    frame->lastQuery = frame->zones[zone].queries[1];
+}
+
+const GpuTimerStats* gputimer_stats(const char* name) {
+    for (int i = 0; i < statsCount; i++)
+        if (strcmp(stats[i].name, name) == 0) return &stats[i];
+    return NULL;
+}
+
+int gputimer_stats_count(void) {
+    return statsCount;
+}
+
+const GpuTimerStats* gputimer_stats_at(int index) {
+    return index >= 0 && index < statsCount ? &stats[index] : NULL;
+}
+
+int gputimer_dropped_frames(void) {
+    return droppedFrames;
+}
+
+void gputimer_dump(FILE* out) {
+    fprintf(out, "gpu timers (ms over %d frames, %d dropped):\n", GPU_TIMER_HISTORY, droppedFrames);
+    for (int i = 0; i < statsCount; i++) {
+        const GpuTimerStats* s = &stats[i];
+        fprintf(out, "  %-16s min %7.3f  avg %7.3f  p95 %7.3f  max %7.3f\n",
+                s->name, s->min, s->avg, s->p95, s->max);
+    }
+}
@@ -0,0 +1,340 @@
+#include <glad/glad.h>
+#include "gldebug.h"
+#include "gputimer.h"
+#include "hud.h"
+#include "renderer.h"
+#include "shader.h"
+#include "stats.h"
+#include "streambuf.h"
+#include "texture.h"
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+/*
+
+   the hud module should only turn engine statistics into an overlay
+   it should NOT measure or count anything, it reads the stats registry and
+   the GPU timers
+
+   every frame the whole overlay is rebuilt as textured quads on the CPU and
+   written to a stream buffer in one go, so it costs a single draw call. text
+   uses a built-in 5x7 font, bars and panels sample a solid cell of the same
+   atlas so nothing has to change state between them
+
+   OWNS: font atlas, overlay vertex stream, overlay VAO
+
+   input: stats_get/stats_times, gputimer statistics
+   output: one renderer_draw_overlay call per frame
+
+*/
+
+#define GLYPH_W 5
+#define GLYPH_H 7
+#define CELL_W 6
+#define CELL_H 8
+#define ATLAS_COLUMNS 16
+#define ATLAS_W (ATLAS_COLUMNS * CELL_W)
+#define ATLAS_H (5 * CELL_H)
+#define FIRST_CHAR ' '
+#define GLYPH_COUNT 64            // ' ' to '_', lower case prints as upper case
+#define SOLID_CELL GLYPH_COUNT    // fully covered cell for rectangles
+
+#define SCALE 2                   // screen pixels per font texel
+#define LINE_H (CELL_H * SCALE + 2)
+#define PADDING 8
+#define GRAPH_W (STATS_HISTORY * 2)
+#define GRAPH_H 80
+#define GRAPH_MS 33.3f            // top of the graph
+
+typedef struct {
+    float x, y;
+    uint8_t color[4];
+    float u, v;
+} HudVertex;
+
+typedef struct {
+    uint8_t r, g, b, a;
+} HudColor;
+
+static const HudColor WHITE = { 255, 255, 255, 255 };
+static const HudColor GREY = { 150, 150, 150, 255 };
+static const HudColor CPU_COLOR = { 90, 220, 110, 255 };
+static const HudColor GPU_COLOR = { 255, 160, 40, 255 };
+static const HudColor BACKGROUND = { 0, 0, 0, 170 };
+static const HudColor GRAPH_BACKGROUND = { 40, 40, 40, 200 };
+static const HudColor BUDGET_COLOR = { 255, 60, 60, 200 };
+
+// classic 5x7 font, five columns per glyph, bit 0 is the top row
+static const uint8_t font5x7[GLYPH_COUNT][GLYPH_W] = {
+    {0x00,0x00,0x00,0x00,0x00}, {0x00,0x00,0x5F,0x00,0x00}, {0x00,0x07,0x00,0x07,0x00}, {0x14,0x7F,0x14,0x7F,0x14}, //  !"#
+    {0x24,0x2A,0x7F,0x2A,0x12}, {0x23,0x13,0x08,0x64,0x62}, {0x36,0x49,0x55,0x22,0x50}, {0x00,0x05,0x03,0x00,0x00}, // $%&'
+    {0x00,0x1C,0x22,0x41,0x00}, {0x00,0x41,0x22,0x1C,0x00}, {0x14,0x08,0x3E,0x08,0x14}, {0x08,0x08,0x3E,0x08,0x08}, // ()*+
+    {0x00,0x50,0x30,0x00,0x00}, {0x08,0x08,0x08,0x08,0x08}, {0x00,0x60,0x60,0x00,0x00}, {0x20,0x10,0x08,0x04,0x02}, // ,-./
+    {0x3E,0x51,0x49,0x45,0x3E}, {0x00,0x42,0x7F,0x40,0x00}, {0x42,0x61,0x51,0x49,0x46}, {0x21,0x41,0x45,0x4B,0x31}, // 0123
+    {0x18,0x14,0x12,0x7F,0x10}, {0x27,0x45,0x45,0x45,0x39}, {0x3C,0x4A,0x49,0x49,0x30}, {0x01,0x71,0x09,0x05,0x03}, // 4567
+    {0x36,0x49,0x49,0x49,0x36}, {0x06,0x49,0x49,0x29,0x1E}, {0x00,0x36,0x36,0x00,0x00}, {0x00,0x56,0x36,0x00,0x00}, // 89:;
+    {0x08,0x14,0x22,0x41,0x00}, {0x14,0x14,0x14,0x14,0x14}, {0x00,0x41,0x22,0x14,0x08}, {0x02,0x01,0x51,0x09,0x06}, // <=>?
+    {0x32,0x49,0x79,0x41,0x3E}, {0x7E,0x11,0x11,0x11,0x7E}, {0x7F,0x49,0x49,0x49,0x36}, {0x3E,0x41,0x41,0x41,0x22}, // @ABC
+    {0x7F,0x41,0x41,0x22,0x1C}, {0x7F,0x49,0x49,0x49,0x41}, {0x7F,0x09,0x09,0x09,0x01}, {0x3E,0x41,0x49,0x49,0x7A}, // DEFG
+    {0x7F,0x08,0x08,0x08,0x7F}, {0x00,0x41,0x7F,0x41,0x00}, {0x20,0x40,0x41,0x3F,0x01}, {0x7F,0x08,0x14,0x22,0x41}, // HIJK
+    {0x7F,0x40,0x40,0x40,0x40}, {0x7F,0x02,0x0C,0x02,0x7F}, {0x7F,0x04,0x08,0x10,0x7F}, {0x3E,0x41,0x41,0x41,0x3E}, // LMNO
+    {0x7F,0x09,0x09,0x09,0x06}, {0x3E,0x41,0x51,0x21,0x5E}, {0x7F,0x09,0x19,0x29,0x46}, {0x46,0x49,0x49,0x49,0x31}, // PQRS
+    {0x01,0x01,0x7F,0x01,0x01}, {0x3F,0x40,0x40,0x40,0x3F}, {0x1F,0x20,0x40,0x20,0x1F}, {0x3F,0x40,0x38,0x40,0x3F}, // TUVW
+    {0x63,0x14,0x08,0x14,0x63}, {0x07,0x08,0x70,0x08,0x07}, {0x61,0x51,0x49,0x45,0x43}, {0x00,0x7F,0x41,0x41,0x00}, // XYZ[
+    {0x02,0x04,0x08,0x10,0x20}, {0x00,0x41,0x41,0x7F,0x00}, {0x04,0x02,0x01,0x02,0x04}, {0x40,0x40,0x40,0x40,0x40}, // \]^_
+};
+
+static Texture atlas;
+static StreamBuffer stream;
+static GLuint vao = 0;
+static Shader* shader = NULL;     // owned by the shader cache, so it hot reloads
+static bool visible = false;
+static bool initialized = false;
+
+static HudVertex vertices[HUD_MAX_QUADS * 6];
+static int quadCount = 0;
+
+static void build_atlas(void) {
+    static uint8_t pixels[ATLAS_W * ATLAS_H];
+    memset(pixels, 0, sizeof(pixels));
+
+    for (int g = 0; g <= GLYPH_COUNT; g++) {
+        int cx = (g % ATLAS_COLUMNS) * CELL_W;
+        int cy = (g / ATLAS_COLUMNS) * CELL_H;
+        for (int y = 0; y < CELL_H; y++) {
+            for (int x = 0; x < CELL_W; x++) {
+                bool on = g == SOLID_CELL ||
+                          (x < GLYPH_W && y < GLYPH_H && (font5x7[g][x] >> y) & 1);
+                pixels[(cy + y) * ATLAS_W + cx + x] = on ? 255 : 0;
+            }
+        }
+    }
+
+    texture_create(&atlas, ATLAS_W, ATLAS_H, 1, pixels);
+    gldebug_label(GL_TEXTURE, atlas.id, "hud font");
+
+    // texels must stay crisp, the mip chain is never sampled
+    glBindTexture(GL_TEXTURE_2D, atlas.id);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+bool hud_init(void) {
+    shader = shader_get_variant("shaders/vs_hud.shdr", "shaders/fs_hud.shdr", 0);
+    if (!shader) {
+        fprintf(stderr, "Failed to load the HUD shader\n");
+        return false;
+    }
+
+    if (!streambuf_init(&stream, sizeof(vertices), 3)) {
+        fprintf(stderr, "Failed to create the HUD vertex stream\n");
+        return false;
+    }
+
+    build_atlas();
+    glGenVertexArrays(1, &vao);
+    initialized = true;
+    return true;
+}
+
+void hud_shutdown(void) {
+    if (!initialized) return;
+    streambuf_destroy(&stream);
+    texture_destroy(&atlas);
+    glDeleteVertexArrays(1, &vao);
+    vao = 0;
+    initialized = false;
+}
+
+void hud_toggle(void) {
+    visible = !visible;
+}
+
+bool hud_visible(void) {
+    return visible;
+}
+
+// one quad showing the atlas texels (u0,v0)-(u1,v1)
+static void push_quad(float x, float y, float w, float h,
+                      float u0, float v0, float u1, float v1, HudColor c) {
+    if (quadCount == HUD_MAX_QUADS) return;
+
+    HudVertex corners[4] = {
+        { x,     y,     { c.r, c.g, c.b, c.a }, u0, v0 },
+        { x + w, y,     { c.r, c.g, c.b, c.a }, u1, v0 },
+        { x + w, y + h, { c.r, c.g, c.b, c.a }, u1, v1 },
+        { x,     y + h, { c.r, c.g, c.b, c.a }, u0, v1 },
+    };
+    HudVertex* v = &vertices[quadCount++ * 6];
+    v[0] = corners[0]; v[1] = corners[1]; v[2] = corners[2];
+    v[3] = corners[2]; v[4] = corners[3]; v[5] = corners[0];
+}
+
+static void push_rect(float x, float y, float w, float h, HudColor c) {
+    // sample the middle of the solid cell
+    float u = ((SOLID_CELL % ATLAS_COLUMNS) * CELL_W + CELL_W * 0.5f) / ATLAS_W;
+    float v = ((SOLID_CELL / ATLAS_COLUMNS) * CELL_H + CELL_H * 0.5f) / ATLAS_H;
+    push_quad(x, y, w, h, u, v, u, v, c);
+}
+
+// returns the x after the last character
+static float push_text(float x, float y, HudColor c, const char* fmt, ...) {
+    char text[128];
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(text, sizeof(text), fmt, args);
+    va_end(args);
+
+    for (const char* s = text; *s; s++) {
+        int ch = *s;
+        if (ch >= 'a' && ch <= 'z') ch -= 'a' - 'A';
+        int g = ch - FIRST_CHAR;
+        if (g > 0 && g < GLYPH_COUNT) {
+            float u0 = (float)((g % ATLAS_COLUMNS) * CELL_W) / ATLAS_W;
+            float v0 = (float)((g / ATLAS_COLUMNS) * CELL_H) / ATLAS_H;
+            push_quad(x, y, GLYPH_W * SCALE, GLYPH_H * SCALE,
+                      u0, v0, u0 + (float)GLYPH_W / ATLAS_W, v0 + (float)GLYPH_H / ATLAS_H, c);
+        }
+        x += CELL_W * SCALE;
+    }
+    return x;
+}
+
+// 12345 -> "12.3K", keeps columns narrow
+static const char* short_count(int64_t n, char* buf, size_t size) {
+    if (n >= 1000000) snprintf(buf, size, "%.2fM", n / 1.0e6);
+    else if (n >= 10000) snprintf(buf, size, "%.1fK", n / 1.0e3);
+    else snprintf(buf, size, "%lld", (long long)n);
+    return buf;
+}
+
+static float graph_height(float ms) {
+    float h = ms / GRAPH_MS * GRAPH_H;
+    return h < 0.0f ? 0.0f : h > GRAPH_H ? GRAPH_H : h;
+}
+
+// newest sample on the right, CPU as bars, GPU as a line of dots on top
+static void push_graph(float x, float y) {
+    push_rect(x, y, GRAPH_W, GRAPH_H, GRAPH_BACKGROUND);
+
+    float step = (float)GRAPH_W / STATS_HISTORY;
+    int cpuCount = stats_sample_count(STATS_CPU_MS);
+    for (int age = 0; age < cpuCount; age++) {
+        float h = graph_height(stats_sample(STATS_CPU_MS, age));
+        push_rect(x + GRAPH_W - (age + 1) * step, y + GRAPH_H - h, step, h, CPU_COLOR);
+    }
+
+    const GpuTimerStats* gpu = gputimer_stats("frame");
+    if (gpu) {
+        for (int age = 0; age < gpu->samples; age++) {
+            float ms = gpu->history[(gpu->head - 1 - age + GPU_TIMER_HISTORY) % GPU_TIMER_HISTORY];
+            float h = graph_height(ms);
+            push_rect(x + GRAPH_W - (age + 1) * step, y + GRAPH_H - h - 1, step, 2, GPU_COLOR);
+        }
+    }
+
+    // 60 Hz budget
+    float budget = graph_height(1000.0f / 60.0f);
+    push_rect(x, y + GRAPH_H - budget, GRAPH_W, 1, BUDGET_COLOR);
+    push_text(x + 4, y + 4, GREY, "%.0f ms", GRAPH_MS);
+}
+
+static void build(void) {
+    quadCount = 0;
+
+    // the panel goes first, its height is only known at the end
+    int panel = quadCount;
+    push_rect(0, 0, 0, 0, BACKGROUND);
+
+    float x = PADDING * 2, y = PADDING * 2;
+    char a[16], b[16], c[16];
+
+    StatsTimes frame = stats_times(STATS_FRAME_MS);
+    StatsTimes cpu = stats_times(STATS_CPU_MS);
+    push_text(x, y, WHITE, "frame %6.2f ms  %5.0f fps", frame.avg, frame.avg > 0.0f ? 1000.0f / frame.avg : 0.0f);
+    y += LINE_H;
+    push_text(x, y, CPU_COLOR, "cpu  last %5.2f avg %5.2f p95 %5.2f p99 %5.2f max %5.2f",
+              cpu.last, cpu.avg, cpu.p95, cpu.p99, cpu.max);
+    y += LINE_H;
+
+    const GpuTimerStats* gpu = gputimer_stats("frame");
+    if (gpu)
+        push_text(x, y, GPU_COLOR, "gpu  last %5.2f avg %5.2f p95 %5.2f max %5.2f",
+                  gpu->last, gpu->avg, gpu->p95, gpu->max);
+    else
+        push_text(x, y, GPU_COLOR, "gpu  no timer results");
+    y += LINE_H + 4;
+
+    push_graph(x, y);
+    y += GRAPH_H + 8;
+
+    push_text(x, y, WHITE, "draws %s  tris %s  state %s",
+              short_count(stats_get(STAT_DRAW_CALLS), a, sizeof(a)),
+              short_count(stats_get(STAT_TRIANGLES), b, sizeof(b)),
+              short_count(stats_get(STAT_STATE_CHANGES), c, sizeof(c)));
+    y += LINE_H;
+    push_text(x, y, WHITE, "objects %lld visible %lld culled",
+              (long long)stats_get(STAT_OBJECTS_VISIBLE), (long long)stats_get(STAT_OBJECTS_CULLED));
+    y += LINE_H;
+    push_text(x, y, WHITE, "memory %.1f MB textures %.1f MB buffers",
+              stats_get(STAT_TEXTURE_BYTES) / (1024.0 * 1024.0),
+              stats_get(STAT_BUFFER_BYTES) / (1024.0 * 1024.0));
+    y += LINE_H + 4;
+
+    push_text(x, y, GREY, "gpu pass          avg    p95    max");
+    y += LINE_H;
+    for (int i = 0; i < gputimer_stats_count(); i++) {
+        const GpuTimerStats* s = gputimer_stats_at(i);
+        push_text(x, y, WHITE, "%-16.16s %6.2f %6.2f %6.2f", s->name, s->avg, s->p95, s->max);
+        y += LINE_H;
+    }
+
+    float width = GRAPH_W + PADDING * 2;
+    float textWidth = (float)strlen("cpu  last 00.00 avg 00.00 p95 00.00 p99 00.00 max 00.00") * CELL_W * SCALE + PADDING * 2;
+    if (textWidth > width) width = textWidth;
+
+    HudVertex* v = &vertices[panel * 6];
+    float x0 = PADDING, y0 = PADDING, x1 = PADDING + width, y1 = y + PADDING;
+    v[0].x = x0; v[0].y = y0;
+    v[1].x = x1; v[1].y = y0;
+    v[2].x = x1; v[2].y = y1;
+    v[3].x = x1; v[3].y = y1;
+    v[4].x = x0; v[4].y = y1;
+    v[5].x = x0; v[5].y = y0;
+}
+
+void hud_draw(int width, int height) {
+    if (!initialized || !visible || !shader || !shader->id) return;
+
+    build();
+
+    GLsizeiptr size = (GLsizeiptr)quadCount * 6 * sizeof(HudVertex);
+    GLintptr offset = 0;
+    // the float position needs 4 byte alignment, the stride does not have to be a power of two
+    void* dst = streambuf_map(&stream, size, 4, &offset);
+    if (!dst) return;
+    memcpy(dst, vertices, size);
+    streambuf_unmap(&stream);
+
+    // the stream buffer may have been orphaned into a new id, point at it every frame
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, stream.id);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(HudVertex), (void*)(offset + offsetof(HudVertex, x)));
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(HudVertex), (void*)(offset + offsetof(HudVertex, color)));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(HudVertex), (void*)(offset + offsetof(HudVertex, u)));
+    glEnableVertexAttribArray(2);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    renderer_draw_overlay(shader, &atlas, vao, quadCount * 6, width, height);
+
+    streambuf_end_frame(&stream);
+}
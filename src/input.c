@@ -4,17 +4,47 @@
 #include "input.h"
 #include <math.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
 
 #include "camera.h"
 
+// everything the game reads from the devices in one frame. input_begin_frame
+// fills it from GLFW or from a replay log, nothing else calls GLFW for input
+typedef struct {
+  float deltaTime;
+  float mouseDx, mouseDy;
+  bool keys[GLFW_KEY_LAST + 1];
+} InputFrame;
+
+// log file: "RBIN", u32 version, then per frame
+//   f32 deltaTime, f32 mouseDx, f32 mouseDy, u16 changes, u16 key[changes]
+// only keys that changed since the previous frame are stored, the top bit of
+// each is the new state. little endian, as written by the host
+#define INPUT_LOG_MAGIC "RBIN"
+#define INPUT_LOG_VERSION 1u
+#define INPUT_LOG_KEY_DOWN 0x8000u
+
 static Camera *camera = NULL;
 
 static float lastX = 800.0f / 2.0f;
 static float lastY = 600.0f / 2.0f;
 static bool firstMouse = true;
 
+// mouse motion since the last input_begin_frame
+static float pendingDx = 0.0f;
+static float pendingDy = 0.0f;
+
 static bool wireframe = false;
-static bool wireframeKeyPressed = false;
+
+static InputFrame current;
+static InputFrame previous;
+
+static FILE *recordFile = NULL;
+static FILE *replayFile = NULL;
+static bool replayDone = false;
+static int logFrames = 0;
 
 static float groundHeight = 0.0f; // y-coordinate of the floor
 static float playerHeight = 1.8f; // camera height above the ground
@@ -22,22 +52,80 @@ static float playerHeight = 1.8f; // camera height above the ground
 static void mouse_callback(GLFWwindow *window, double xpos, double ypos) {
   (void)window;
 
-  if (!camera)
-    return;
-
   if (firstMouse) {
     lastX = (float)xpos;
     lastY = (float)ypos;
     firstMouse = false;
   }
 
-  float xoffset = (float)xpos - lastX;
-  float yoffset = lastY - (float)ypos;
+  pendingDx += (float)xpos - lastX;
+  pendingDy += lastY - (float)ypos;
 
   lastX = (float)xpos;
   lastY = (float)ypos;
+}
+
+static void poll_devices(GLFWwindow *win, float deltaTime) {
+  current.deltaTime = deltaTime;
+  current.mouseDx = pendingDx;
+  current.mouseDy = pendingDy;
+  pendingDx = pendingDy = 0.0f;
+
+  memset(current.keys, 0, sizeof(current.keys));
+  if (!win)
+    return;
+  for (int key = GLFW_KEY_SPACE; key <= GLFW_KEY_LAST; key++)
+    current.keys[key] = glfwGetKey(win, key) == GLFW_PRESS;
+}
+
+static void write_frame(void) {
+  uint16_t changed[GLFW_KEY_LAST + 1];
+  uint16_t changes = 0;
+  for (int key = 0; key <= GLFW_KEY_LAST; key++)
+    if (current.keys[key] != previous.keys[key])
+      changed[changes++] =
+          (uint16_t)key | (current.keys[key] ? INPUT_LOG_KEY_DOWN : 0);
+
+  float header[3] = {current.deltaTime, current.mouseDx, current.mouseDy};
+  if (fwrite(header, sizeof(header), 1, recordFile) != 1 ||
+      fwrite(&changes, sizeof(changes), 1, recordFile) != 1 ||
+      fwrite(changed, sizeof(uint16_t), changes, recordFile) != changes) {
+    fprintf(stderr, "Input recording failed after %d frames\n", logFrames);
+    fclose(recordFile);
+    recordFile = NULL;
+    return;
+  }
+  logFrames++;
+}
+
+static bool read_frame(void) {
+  float header[3];
+  uint16_t changes;
+  if (fread(header, sizeof(header), 1, replayFile) != 1 ||
+      fread(&changes, sizeof(changes), 1, replayFile) != 1)
+    return false;
 
-  camera_process_mouse(camera, xoffset, yoffset, true);
+  current.deltaTime = header[0];
+  current.mouseDx = header[1];
+  current.mouseDy = header[2];
+  memcpy(current.keys, previous.keys, sizeof(current.keys));
+  for (uint16_t i = 0; i < changes; i++) {
+    uint16_t code;
+    if (fread(&code, sizeof(code), 1, replayFile) != 1)
+      return false;
+    int key = code & ~INPUT_LOG_KEY_DOWN;
+    if (key <= GLFW_KEY_LAST)
+      current.keys[key] = (code & INPUT_LOG_KEY_DOWN) != 0;
+  }
+  logFrames++;
+  return true;
+}
+
+static FILE *open_log(const char *path, const char *mode) {
+  FILE *f = fopen(path, mode);
+  if (!f)
+    fprintf(stderr, "Cannot open input log %s\n", path);
+  return f;
 }
 
 // --------------------------------------------------
@@ -46,42 +134,116 @@ static void mouse_callback(GLFWwindow *window, double xpos, double ypos) {
 
 void input_set_camera(Camera *cam) { camera = cam; }
 
+// every call is a no-op without a window, e.g. headless runs
 void input_init(GLFWwindow *window) {
+  if (!window)
+    return;
+
   glfwSetCursorPosCallback(window, mouse_callback);
   glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 }
 
+bool input_record_start(const char *path) {
+  recordFile = open_log(path, "wb");
+  if (!recordFile)
+    return false;
+
+  uint32_t version = INPUT_LOG_VERSION;
+  fwrite(INPUT_LOG_MAGIC, 4, 1, recordFile);
+  fwrite(&version, sizeof(version), 1, recordFile);
+  logFrames = 0;
+  return true;
+}
+
+bool input_replay_start(const char *path) {
+  replayFile = open_log(path, "rb");
+  if (!replayFile)
+    return false;
+
+  char magic[4];
+  uint32_t version = 0;
+  if (fread(magic, 4, 1, replayFile) != 1 ||
+      memcmp(magic, INPUT_LOG_MAGIC, 4) != 0 ||
+      fread(&version, sizeof(version), 1, replayFile) != 1 ||
+      version != INPUT_LOG_VERSION) {
+    fprintf(stderr, "%s is not an input log of version %u\n", path,
+            INPUT_LOG_VERSION);
+    fclose(replayFile);
+    replayFile = NULL;
+    return false;
+  }
+  replayDone = false;
+  logFrames = 0;
+  return true;
+}
+
+bool input_replay_finished(void) { return replayDone; }
+
+void input_begin_frame(GLFWwindow *win, float *deltaTime) {
+  previous = current;
+  poll_devices(win, *deltaTime);
+
+  if (recordFile)
+    write_frame();
+
+  if (replayFile) {
+    if (read_frame()) {
+      *deltaTime = current.deltaTime;
+    } else {
+      printf("Replay finished after %d frames\n", logFrames);
+      fclose(replayFile);
+      replayFile = NULL;
+      replayDone = true;
+      // live input from here on, nothing stays held from the log
+      memset(current.keys, 0, sizeof(current.keys));
+    }
+  }
+}
+
+bool input_key_down(int key) {
+  return key >= 0 && key <= GLFW_KEY_LAST && current.keys[key];
+}
+
+bool input_key_pressed(GLFWwindow *win, int key) {
+  (void)win;
+  return input_key_down(key) && !previous.keys[key];
+}
+
+void input_update_frame(GLFWwindow *win) {
+  if (!camera)
+    return;
+
+  // Look, at the display rate so the mouse never waits for a simulation step
+  if (current.mouseDx != 0.0f || current.mouseDy != 0.0f)
+    camera_process_mouse(camera, current.mouseDx, current.mouseDy, true);
+
+  // Wireframe toggle (F1), the renderer applies it with the frame
+  if (input_key_pressed(win, GLFW_KEY_F1))
+    wireframe = !wireframe;
+}
+
+bool input_wireframe(void) { return wireframe; }
+
 void input_update(GLFWwindow *win, float deltaTime, float roomW, float roomH,
                   float roomD) {
+  (void)win;
   if (!camera)
     return;
 
   // Movement
-  if (glfwGetKey(win, GLFW_KEY_W) == GLFW_PRESS)
+  if (input_key_down(GLFW_KEY_W))
     camera_process_keyboard(camera, CAMERA_FORWARD, deltaTime);
-  if (glfwGetKey(win, GLFW_KEY_S) == GLFW_PRESS)
+  if (input_key_down(GLFW_KEY_S))
     camera_process_keyboard(camera, CAMERA_BACKWARD, deltaTime);
-  if (glfwGetKey(win, GLFW_KEY_A) == GLFW_PRESS)
+  if (input_key_down(GLFW_KEY_A))
     camera_process_keyboard(camera, CAMERA_LEFT, deltaTime);
-  if (glfwGetKey(win, GLFW_KEY_D) == GLFW_PRESS)
+  if (input_key_down(GLFW_KEY_D))
     camera_process_keyboard(camera, CAMERA_RIGHT, deltaTime);
-  if (glfwGetKey(win, GLFW_KEY_SPACE) == GLFW_PRESS)
+  if (input_key_down(GLFW_KEY_SPACE))
     camera_process_keyboard(camera, CAMERA_UP, deltaTime);
-  if (glfwGetKey(win, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS)
+  if (input_key_down(GLFW_KEY_LEFT_SHIFT))
     camera_process_keyboard(camera, CAMERA_DOWN, deltaTime);
 
-  // Wireframe toggle (F1)
-  if (glfwGetKey(win, GLFW_KEY_F1) == GLFW_PRESS && !wireframeKeyPressed) {
-    wireframe = !wireframe;
-    wireframeKeyPressed = true;
-
-    glPolygonMode(GL_FRONT_AND_BACK, wireframe ? GL_LINE : GL_FILL);
-  }
-
-  if (glfwGetKey(win, GLFW_KEY_F1) == GLFW_RELEASE) {
-    wireframeKeyPressed = false;
-  }
-
   // Room bounds + fixed player height
   camera->Position[0] = fmaxf(-roomW / 2.0f + 0.5f,
                               fminf(camera->Position[0], roomW / 2.0f - 0.5f));
@@ -91,3 +253,15 @@ void input_update(GLFWwindow *win, float deltaTime, float roomW, float roomH,
   camera->Position[2] = fmaxf(-roomD / 2.0f + 0.5f,
                               fminf(camera->Position[2], roomD / 2.0f - 0.5f));
 }
+
+void input_shutdown(void) {
+  if (recordFile) {
+    printf("Recorded %d frames of input\n", logFrames);
+    fclose(recordFile);
+    recordFile = NULL;
+  }
+  if (replayFile) {
+    fclose(replayFile);
+    replayFile = NULL;
+  }
+}
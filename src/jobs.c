@@ -0,0 +1,297 @@
+#define _POSIX_C_SOURCE 200809L // sysconf
+#include "jobs.h"
+#include "profiler.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <threads.h>
+#include <unistd.h>
+
+/*
+
+   the jobs module should only run small pieces of work on every core
+   it should NOT know what the work is, nor touch GL: workers have no context
+
+   every thread that queues jobs owns a Chase-Lev deque. the owner pushes
+   and pops at the bottom without locks, idle threads steal from the top of
+   a random other deque with one compare-and-swap. a thread waiting on a
+   counter runs queued jobs instead of blocking, so waiting never deadlocks
+   and the main thread is one more worker while it waits
+
+   jobs live in a ring per owner, twice the deque size, at the position
+   they were pushed to. push refuses a full deque, so the slot of a job
+   still queued is never written; a thief reading a slot the owner is
+   rewriting has already lost the job to someone else and drops its copy
+
+   workers with nothing to steal sleep on a condition variable. `queued`
+   counts jobs in the deques and `sleeping` the workers asleep, a push only
+   takes the lock when someone sleeps
+
+   OWNS: the worker threads, the deques and the jobs in them
+
+   input: jobs and ranges from the main thread and from running jobs
+   output: the work done, counters at zero
+
+*/
+
+#define JOBS_POOL_SIZE (JOBS_DEQUE_SIZE * 2)
+
+typedef struct {
+    JobFn fn;
+    JobRangeFn range;   // instead of fn, for parallel_for chunks
+    void* user;
+    int begin, end;
+    JobCounter* counter;
+} Job;
+
+typedef struct {
+    _Alignas(64) atomic_llong top;      // thieves take from here
+    _Alignas(64) atomic_llong bottom;   // the owner pushes and pops here
+    _Atomic(Job*) items[JOBS_DEQUE_SIZE];
+    Job pool[JOBS_POOL_SIZE];
+    thrd_t thread;
+} Deque;
+
+// [0] is the thread that called jobs_init, then the workers
+static Deque deques[JOBS_MAX_WORKERS + 1];
+static int workerCount = 0;
+
+static _Thread_local int self = -1;    // deque of the calling thread
+static _Thread_local uint32_t victimRng = 0;
+
+static mtx_t lock;
+static cnd_t wake;
+static atomic_int queued = 0;
+static atomic_int sleeping = 0;
+static atomic_bool stopping = false;
+
+static bool push(Deque* d, const Job* job) {
+    long long b = atomic_load_explicit(&d->bottom, memory_order_relaxed);
+    long long t = atomic_load_explicit(&d->top, memory_order_acquire);
+    if (b - t >= JOBS_DEQUE_SIZE) return false;
+
+    Job* slot = &d->pool[b % JOBS_POOL_SIZE];
+    *slot = *job;
+    atomic_store_explicit(&d->items[b % JOBS_DEQUE_SIZE], slot, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+    return true;
+}
+
+// owner only, newest first so the caches are still warm
+static bool pop(Deque* d, Job* out) {
+    long long b = atomic_load_explicit(&d->bottom, memory_order_relaxed) - 1;
+    atomic_store_explicit(&d->bottom, b, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    long long t = atomic_load_explicit(&d->top, memory_order_relaxed);
+
+    if (t > b) {
+        atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+        return false;
+    }
+
+    Job* job = atomic_load_explicit(&d->items[b % JOBS_DEQUE_SIZE], memory_order_relaxed);
+    bool won = true;
+    if (t == b) {
+        // the last job, a thief may be taking it from the top
+        won = atomic_compare_exchange_strong_explicit(&d->top, &t, t + 1, memory_order_seq_cst,
+                                                      memory_order_relaxed);
+        atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+    }
+    if (won) *out = *job;
+    return won;
+}
+
+// any thread, oldest first
+static bool steal(Deque* d, Job* out) {
+    long long t = atomic_load_explicit(&d->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    long long b = atomic_load_explicit(&d->bottom, memory_order_acquire);
+    if (t >= b) return false;
+
+    Job* job = atomic_load_explicit(&d->items[t % JOBS_DEQUE_SIZE], memory_order_relaxed);
+    Job copy = *job;
+    if (!atomic_compare_exchange_strong_explicit(&d->top, &t, t + 1, memory_order_seq_cst,
+                                                 memory_order_relaxed))
+        return false;
+    *out = copy;
+    return true;
+}
+
+static bool take(Job* out) {
+    if (self >= 0 && pop(&deques[self], out)) {
+        atomic_fetch_sub(&queued, 1);
+        return true;
+    }
+
+    // xorshift, every thief starting somewhere else keeps them off each other
+    uint32_t x = victimRng ? victimRng : (uint32_t)(self + 2) * 2654435761u;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    victimRng = x;
+
+    int count = workerCount + 1;
+    for (int i = 0; i < count; i++) {
+        int victim = (int)((x + (uint32_t)i) % (uint32_t)count);
+        if (victim != self && steal(&deques[victim], out)) {
+            atomic_fetch_sub(&queued, 1);
+            return true;
+        }
+    }
+    return false;
+}
+
+static void execute(const Job* job) {
+    {
+        PROFILE_ZONE("job");
+        if (job->range)
+            job->range(job->begin, job->end, job->user);
+        else
+            job->fn(job->user);
+    }
+    // the counter may be gone the moment it reads zero, touch nothing after
+    if (job->counter) atomic_fetch_sub_explicit(&job->counter->pending, 1, memory_order_release);
+}
+
+static void wake_workers(bool all) {
+    if (atomic_load(&sleeping) == 0) return;
+    mtx_lock(&lock);
+    if (all)
+        cnd_broadcast(&wake);
+    else
+        cnd_signal(&wake);
+    mtx_unlock(&lock);
+}
+
+// queued before it is pushed, a worker that sees zero and sleeps missed nothing
+static bool queue(const Job* job) {
+    if (self < 0 || workerCount == 0) return false;
+    atomic_fetch_add(&queued, 1);
+    if (push(&deques[self], job)) return true;
+    atomic_fetch_sub(&queued, 1);
+    return false;
+}
+
+static int worker_main(void* arg) {
+    self = (int)(intptr_t)arg;
+    PROFILE_THREAD("job worker");
+
+    for (;;) {
+        Job job;
+        if (take(&job)) {
+            execute(&job);
+            continue;
+        }
+        if (atomic_load(&stopping)) break;
+
+        // the seq_cst pair with queue(): either this sees the job or the
+        // pusher sees this thread asleep
+        mtx_lock(&lock);
+        atomic_fetch_add(&sleeping, 1);
+        while (atomic_load(&queued) <= 0 && !atomic_load(&stopping)) cnd_wait(&wake, &lock);
+        atomic_fetch_sub(&sleeping, 1);
+        mtx_unlock(&lock);
+    }
+    return 0;
+}
+
+bool jobs_init(int workers) {
+    if (workers < 0) {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        workers = cores > 1 ? (int)cores - 1 : 0;
+    }
+    if (workers > JOBS_MAX_WORKERS) workers = JOBS_MAX_WORKERS;
+
+    memset(deques, 0, sizeof(deques));
+    atomic_store(&queued, 0);
+    atomic_store(&sleeping, 0);
+    atomic_store(&stopping, false);
+    self = 0;
+    workerCount = 0;
+    if (workers == 0) return true;
+
+    if (mtx_init(&lock, mtx_plain) != thrd_success || cnd_init(&wake) != thrd_success) {
+        fprintf(stderr, "Failed to create the job system's locks\n");
+        return false;
+    }
+
+    // workerCount grows as threads start, a thread that fails leaves the rest
+    for (int i = 1; i <= workers; i++) {
+        if (thrd_create(&deques[i].thread, worker_main, (void*)(intptr_t)i) != thrd_success) {
+            fprintf(stderr, "Started %d of %d job workers\n", i - 1, workers);
+            break;
+        }
+        workerCount = i;
+    }
+    return true;
+}
+
+void jobs_shutdown(void) {
+    if (workerCount > 0) {
+        mtx_lock(&lock);
+        atomic_store(&stopping, true);
+        cnd_broadcast(&wake);
+        mtx_unlock(&lock);
+
+        for (int i = 1; i <= workerCount; i++) thrd_join(deques[i].thread, NULL);
+        cnd_destroy(&wake);
+        mtx_destroy(&lock);
+    }
+
+    // jobs the main thread pushed after the workers left
+    Job job;
+    while (take(&job)) execute(&job);
+    workerCount = 0;
+    self = -1;
+}
+
+int jobs_worker_count(void) {
+    return workerCount;
+}
+
+void jobs_run(JobFn fn, void* user, JobCounter* counter) {
+    Job job = { fn, NULL, user, 0, 0, counter };
+    if (counter) atomic_fetch_add_explicit(&counter->pending, 1, memory_order_relaxed);
+
+    if (queue(&job))
+        wake_workers(false);
+    else
+        execute(&job);
+}
+
+void jobs_wait(JobCounter* counter) {
+    while (atomic_load_explicit(&counter->pending, memory_order_acquire) > 0) {
+        Job job;
+        if (take(&job))
+            execute(&job);
+        else
+            thrd_yield();
+    }
+}
+
+void jobs_parallel_for(int count, int minChunk, JobRangeFn fn, void* user) {
+    if (count <= 0) return;
+
+    // four chunks a thread, so one slow chunk does not leave the others idle
+    int threads = workerCount + 1;
+    int chunk = (count + threads * 4 - 1) / (threads * 4);
+    if (chunk < minChunk) chunk = minChunk;
+    if (chunk >= count || workerCount == 0 || self < 0) {
+        fn(0, count, user);
+        return;
+    }
+
+    PROFILE_ZONE("parallel_for");
+    JobCounter counter = { 0 };
+    for (int begin = chunk; begin < count; begin += chunk) {
+        Job job = { NULL, fn, user, begin, begin + chunk < count ? begin + chunk : count, &counter };
+        atomic_fetch_add_explicit(&counter.pending, 1, memory_order_relaxed);
+        if (!queue(&job)) execute(&job);
+    }
+    wake_workers(true);
+
+    // the first chunk is the caller's, the rest it helps with while waiting
+    fn(0, chunk, user);
+    jobs_wait(&counter);
+}
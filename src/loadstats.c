@@ -0,0 +1,111 @@
+#include <glad/glad.h>
+#include "loadstats.h"
+#include "timing.h"
+#include <stdio.h>
+#include <string.h>
+
+/*
+
+   the loadstats module should only attribute asset load time to stages
+   it should NOT load anything, the loaders mark their own stage boundaries
+
+   loads nest (a model loads its textures), so every open load remembers how
+   much of its time went to children and leaves that out of its own stages
+
+   OWNS: load records
+
+   input: begin/stage/end marks from texture, model and shader loading
+   output: per-load stage times for tools/bench_load.c
+
+*/
+
+typedef struct {
+    int record;
+    double begin;
+    double mark;        // end of the previous stage
+    double nested;      // time in child loads since mark
+} OpenLoad;
+
+static const char* stageNames[LOAD_STAGE_COUNT] = { "read", "decode", "convert", "upload", "mips" };
+
+static bool enabled = false;
+
+static LoadRecord records[LOADSTATS_MAX_RECORDS];
+static int recordCount = 0;
+
+static OpenLoad openLoads[LOADSTATS_MAX_DEPTH];
+static int depth = 0;
+static int hidden = 0;          // loads past the record or depth limits
+
+void loadstats_enable(bool on) {
+    enabled = on;
+}
+
+void loadstats_begin(const char* kind, const char* path) {
+    if (!enabled) return;
+    if (depth == LOADSTATS_MAX_DEPTH || recordCount == LOADSTATS_MAX_RECORDS || hidden) {
+        hidden++;
+        return;
+    }
+
+    LoadRecord* r = &records[recordCount];
+    memset(r, 0, sizeof(*r));
+    snprintf(r->kind, sizeof(r->kind), "%s", kind);
+    snprintf(r->path, sizeof(r->path), "%s", path);
+    r->depth = depth;
+
+    OpenLoad* o = &openLoads[depth++];
+    o->record = recordCount++;
+    o->begin = o->mark = time_now();
+    o->nested = 0.0;
+}
+
+void loadstats_stage(LoadStage stage) {
+    if (!enabled || depth == 0 || hidden) return;
+
+    // GL calls return before the driver is done with them
+    if (stage == LOAD_UPLOAD || stage == LOAD_MIPS) glFinish();
+
+    OpenLoad* o = &openLoads[depth - 1];
+    double now = time_now();
+    records[o->record].stageMs[stage] += (now - o->mark - o->nested) * 1000.0;
+    o->mark = now;
+    o->nested = 0.0;
+}
+
+void loadstats_bytes(int64_t bytes) {
+    if (!enabled || depth == 0 || hidden) return;
+    records[openLoads[depth - 1].record].bytes += bytes;
+}
+
+void loadstats_end(void) {
+    if (!enabled) return;
+    if (hidden) {
+        hidden--;
+        return;
+    }
+    if (depth == 0) return;
+
+    OpenLoad* o = &openLoads[--depth];
+    double total = time_now() - o->begin;
+    records[o->record].totalMs = total * 1000.0;
+    if (depth > 0) openLoads[depth - 1].nested += total;
+}
+
+int loadstats_count(void) {
+    return recordCount;
+}
+
+const LoadRecord* loadstats_at(int index) {
+    return index >= 0 && index < recordCount ? &records[index] : NULL;
+}
+
+const char* loadstats_stage_name(LoadStage stage) {
+    return stage < LOAD_STAGE_COUNT ? stageNames[stage] : "?";
+}
+
+void loadstats_clear(void) {
+    recordCount = 0;
+    depth = 0;
+    hidden = 0;
+}
@@ -2,20 +2,35 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 // leave this alone clang
+#include "bench.h"
 #include "camera.h"
+#include "fixedstep.h"
+#include "framegraph.h"
+#include "gldebug.h"
+#include "gputimer.h"
+#include "hud.h"
 #include "input.h"
+#include "jobs.h"
+#include "material.h"
 #include "mesh.h"
 #include "model.h"
+#include "profiler.h"
 #include "renderer.h"
+#include "renderthread.h"
 #include "shader.h"
+#include "skybox.h"
+#include "stats.h"
+#include "stress.h"
 #include "texture.h"
-#include "time.h"
+#include "timing.h"
 #include "window.h"
 #include <GLFW/glfw3.h>
 #include <cglm/cglm.h>
 #include <glad/glad.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 /*
 
@@ -25,6 +40,8 @@
    - update input
    - update game state
    - call renderer to draw the scene
+   - hand each built frame to the render thread, which owns GL after startup
+   - start the job workers that culling, animation and loading fan out on
 
    it should NOT directly create VAOs, bind buffers, or manage shader
    compilation it should NOT contain hardcoded geometry transformations inline
@@ -38,19 +55,286 @@
 
 Camera camera;
 
-int main(void) {
+typedef struct {
+  Mesh *plane;
+  MaterialId floorMat;
+  MaterialId wallMat;
+  Model *chair;
+  Skybox *sky; // NULL falls back to a flat sky color
+  StressScene *stress; // --scene, drawn along with the room
+  float roomW, roomD;
+} SceneView;
+
+// main thread: everything the room draws goes into the frame's list
+static void queue_scene(const SceneView *scene) {
+  // floor 
+  renderer_draw_quad(scene->plane, scene->floorMat, (vec3){0, 0, 0}, scene->roomW, scene->roomD, PLANE_FLOOR);
+
+  // front wall
+  renderer_draw_quad(scene->plane, scene->wallMat, (vec3){0.0f, 1.5f, -5.0f}, 5.0f, 3.0f, PLANE_WALL_Z);
+
+  // side wall
+  renderer_draw_quad(scene->plane, scene->wallMat, (vec3){3.0f, 1.5f, 0.0f}, 4.0f, 3.0f, PLANE_WALL_X);
+
+  // draw model
+  mat4 chairModel;
+  glm_mat4_identity(chairModel);
+  glm_translate(chairModel, (vec3){1.0f, 0.0f, -1.0f});
+  glm_scale(chairModel, (vec3){0.5f, 0.5f, 0.5f});
+  renderer_draw_model(scene->chair, chairModel);
+
+  if (scene->stress)
+    stress_draw(scene->stress);
+}
+
+static void scene_pass(void *user) {
+  SceneView *scene = user;
+
+  // the skybox pass paints every pixel left empty, so only depth needs a clear
+  if (scene->sky)
+    renderer_clear_depth();
+  else
+    renderer_clear((vec4){0.53f, 0.81f, 0.92f, 1.0f}); // sky color
+
+  renderer_flush();
+}
+
+static void skybox_pass(void *user) {
+  SceneView *scene = user;
+  renderer_draw_skybox(scene->sky);
+}
+
+static void hud_pass(void *user) {
+  Window *window = user;
+  hud_draw(window->width, window->height);
+}
+
+// what the render thread draws with, besides the packet
+typedef struct {
+  Window *window;
+  FrameGraph *graph;
+  SceneView *scene;
+  Bench *bench; // NULL unless benchmarking
+} RenderState;
+
+// render thread: the GL half of a frame, from a packet the main thread built
+static void render_frame(FramePacket *packet, void *user) {
+  RenderState *state = user;
+  FrameGraph *graph = state->graph;
+  Window *window = state->window;
+  uint64_t renderBegin = time_now_ns();
+
+  shader_watch_poll();
+  if (packet->toggleHud)
+    hud_toggle();
+  renderer_use_list(&packet->list);
+
+  gputimer_begin_frame();
+
+  {
+    PROFILE_ZONE("render");
+    framegraph_begin(graph);
+    FgResourceId backbuffer = framegraph_import_target(
+        graph, "backbuffer", window->framebuffer, window->width,
+        window->height);
+
+    int scenePass = framegraph_add_pass(graph, "scene", scene_pass, state->scene);
+    framegraph_write(graph, scenePass, backbuffer);
+
+    // after the opaque geometry, so early-Z rejects every covered pixel
+    if (state->scene->sky) {
+      int skyPass = framegraph_add_pass(graph, "skybox", skybox_pass, state->scene);
+      framegraph_write(graph, skyPass, backbuffer);
+    }
+
+    if (hud_visible()) {
+      int hudPass = framegraph_add_pass(graph, "hud", hud_pass, window);
+      framegraph_write(graph, hudPass, backbuffer);
+    }
+
+    if (framegraph_compile(graph))
+      framegraph_execute(graph);
+  }
+
+  gputimer_end_frame();
+
+  // F2 prints the graph compiled for this frame and what its passes cost
+  if (packet->dumpStats) {
+    framegraph_dump(graph, stdout);
+    gputimer_dump(stdout);
+    stats_dump(stdout);
+    gldebug_dump(stdout);
+  }
+
+  // CPU time is both threads' work on the frame, before the swap
+  float cpuMs = packet->cpuMs + (float)((time_now_ns() - renderBegin) * 1e-6);
+  stats_end_frame(packet->frameMs, cpuMs);
+  if (state->bench)
+    bench_record(state->bench, packet->frame, packet->frameMs, cpuMs);
+
+  if (packet->screenshotPath &&
+      window_save_ppm(window, packet->screenshotPath))
+    printf("Saved frame %d to %s\n", packet->frame + 1, packet->screenshotPath);
+}
+
+int main(int argc, char **argv) {
+  // --trace <file> writes the CPU zones of the last frames when the app exits
+  // --gl-debug reports driver warnings, labelled with the asset behind them
+  // --headless renders offscreen through EGL, no display needed
+  // --size WxH sets the window or offscreen size
+  // --frames N quits after N frames, --screenshot <file.ppm> saves the last one
+  // --bench <script> flies a scripted camera at a fixed step, without vsync,
+  // and writes --report <file.json> (bench_report.json)
+  // --record <file> logs every frame's input, --replay <file> plays it back
+  // with the recorded delta times and quits at its end
+  // --scene kind:count[:seed] adds a stress scene (chairs, lights, quads,
+  // hierarchy) to the room
+  // --sim-hz <hz> sets the fixed simulation rate (120), drawing interpolates
+  // between the last two steps at whatever rate the display runs
+  // --fps <n> caps the frame rate, --vsync off|on|adaptive sets the swap
+  // interval (on)
+  // --frames-in-flight 1|2|3 frames the main thread may build ahead of the
+  // render thread (2), 1 renders on the main thread
+  // --jobs <n> job worker threads for culling, animation and asset decoding,
+  // one per core beside the main thread by default, 0 runs every job inline
+  const char *tracePath = NULL;
+  const char *screenshotPath = NULL;
+  const char *benchPath = NULL;
+  const char *reportPath = "bench_report.json";
+  const char *recordPath = NULL;
+  const char *replayPath = NULL;
+  const char *sceneSpec = NULL;
+  bool glDebug = false;
+  bool headless = false;
+  int width = (int)WINDOW_WIDTH, height = (int)WINDOW_HEIGHT;
+  int maxFrames = 0;
+  float simHz = FIXEDSTEP_DEFAULT_HZ;
+  double fpsLimit = 0.0;
+  bool setVsync = false;
+  WindowVsync vsync = WINDOW_VSYNC_ON;
+  int framesInFlight = 2;
+  int jobWorkers = -1;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+      tracePath = argv[++i];
+    else if (strcmp(argv[i], "--gl-debug") == 0)
+      glDebug = true;
+    else if (strcmp(argv[i], "--headless") == 0)
+      headless = true;
+    else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+      if (sscanf(argv[++i], "%dx%d", &width, &height) != 2 || width <= 0 ||
+          height <= 0) {
+        fprintf(stderr, "--size expects WIDTHxHEIGHT\n");
+        return 1;
+      }
+    } else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+      maxFrames = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--screenshot") == 0 && i + 1 < argc)
+      screenshotPath = argv[++i];
+    else if (strcmp(argv[i], "--bench") == 0 && i + 1 < argc)
+      benchPath = argv[++i];
+    else if (strcmp(argv[i], "--report") == 0 && i + 1 < argc)
+      reportPath = argv[++i];
+    else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+      recordPath = argv[++i];
+    else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+      replayPath = argv[++i];
+    else if (strcmp(argv[i], "--scene") == 0 && i + 1 < argc)
+      sceneSpec = argv[++i];
+    else if (strcmp(argv[i], "--sim-hz") == 0 && i + 1 < argc) {
+      simHz = (float)atof(argv[++i]);
+      if (simHz <= 0.0f) {
+        fprintf(stderr, "--sim-hz expects a rate above 0\n");
+        return 1;
+      }
+    } else if (strcmp(argv[i], "--frames-in-flight") == 0 && i + 1 < argc)
+      framesInFlight = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc)
+      jobWorkers = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--fps") == 0 && i + 1 < argc)
+      fpsLimit = atof(argv[++i]);
+    else if (strcmp(argv[i], "--vsync") == 0 && i + 1 < argc) {
+      const char *mode = argv[++i];
+      setVsync = true;
+      if (strcmp(mode, "off") == 0)
+        vsync = WINDOW_VSYNC_OFF;
+      else if (strcmp(mode, "on") == 0)
+        vsync = WINDOW_VSYNC_ON;
+      else if (strcmp(mode, "adaptive") == 0)
+        vsync = WINDOW_VSYNC_ADAPTIVE;
+      else {
+        fprintf(stderr, "--vsync expects off, on or adaptive\n");
+        return 1;
+      }
+    }
+  }
+
+  // the script decides how many frames run
+  static Bench bench;
+  if (benchPath) {
+    if (!bench_load(&bench, benchPath))
+      return 1;
+    maxFrames = bench_total_frames(&bench);
+  }
+
+  // nobody can close a headless window, a replay ends by itself
+  if (headless && maxFrames <= 0 && !replayPath) {
+    maxFrames = 300;
+    printf("Headless run without --frames, stopping after %d\n", maxFrames);
+  }
+
+  profiler_init();
+  PROFILE_THREAD("main");
+  if (!jobs_init(jobWorkers))
+    return 1;
 
   Window window;
-  if (!window_create(&window, WINDOW_WIDTH, WINDOW_HEIGHT, "redbox"))
+  window_hint_debug(glDebug);
+  window_hint_headless(headless);
+  if (!window_create(&window, width, height, "redbox"))
     return 1;
 
+  // a benchmark measures the frame, not the wait for the display
+  if (benchPath) {
+    window_set_vsync(&window, WINDOW_VSYNC_OFF);
+  } else {
+    if (setVsync)
+      window_set_vsync(&window, vsync);
+    time_set_frame_limit(fpsLimit);
+  }
+
+  // before anything is created, so every object gets its label
+  if (glDebug)
+    gldebug_init();
+
   if (!renderer_init())
     return 1;
 
+  // asset and shader loading, compare runs with and without .shadercache/
+  double startupBegin = time_now();
+
   camera_init(&camera, (vec3){0.0f, 1.0f, 3.0f}, (vec3){0.0f, 1.0f, 0.0f},
               -90.0f, 0.0f);
   input_init(window.handle);
   input_set_camera(&camera);
+  if (recordPath && !input_record_start(recordPath))
+    return 1;
+  if (replayPath && !input_replay_start(replayPath))
+    return 1;
+
+  // every material draws with a variant of the surface shader
+  const char *surfaceVert = "shaders/vs_surface.shdr";
+  const char *surfaceFrag = "shaders/fs_surface.shdr";
+  if (!material_system_init(surfaceVert, surfaceFrag)) {
+    fprintf(stderr, "Failed to load shaders\n");
+    return 1;
+  }
+
+  // the variants imported materials use compile while textures and the
+  // model below are decoded, nothing waits on them until the first frame
+  shader_request_variant(surfaceVert, surfaceFrag, SHADER_FEATURE_PBR);
+  shader_request_variant(surfaceVert, surfaceFrag,
+                         SHADER_FEATURE_PBR | SHADER_FEATURE_NORMAL_MAP);
 
   Texture floorTex, wallTex, cubeTex;
   if (!texture_load(&floorTex, "assets/grass.png") ||
@@ -59,6 +343,12 @@ int main(void) {
     fprintf(stderr, "Failed to load textures\n");
     return 1;
   }
+  shader_poll_pending();
+
+  MaterialId floorMat = material_create("floor", 0);
+  material_get(floorMat)->textures[MATERIAL_SLOT_ALBEDO] = &floorTex;
+  MaterialId wallMat = material_create("wall", 0);
+  material_get(wallMat)->textures[MATERIAL_SLOT_ALBEDO] = &wallTex;
 
   Mesh planeMesh;
   mesh_init_plane(&planeMesh, 1.0f, 1.0f,
@@ -69,56 +359,188 @@ int main(void) {
     fprintf(stderr, "Failed to load chair model\n");
     return 1;
   }
+  shader_poll_pending();
 
   float roomW = 100.0f, roomD = 100.0f, roomH = 20.0f;
 
-  Shader basicShader;
-  shader_load(&basicShader, "shaders/vert.shdr", "shaders/frag.shdr");
-  renderer_set_shader(&basicShader);
-
   mat4 projection;
-  glm_perspective(glm_rad(45.0f), WINDOW_WIDTH / WINDOW_HEIGHT, 0.1f, 100.0f,
-                  projection);
+  glm_perspective(glm_rad(45.0f), (float)window.width / (float)window.height,
+                  0.1f, 100.0f, projection);
   renderer_set_projection(projection);
 
   renderer_set_light((vec3){2.0f, 4.0f, 2.0f});
 
-  while (!window_should_close(&window)) {
-    float deltaTime = time_update();
+  Skybox sky;
+  bool hasSky = skybox_load(&sky, "assets/skybox/sadcat.jpg");
+  if (!hasSky)
+    fprintf(stderr, "No skybox, using a flat sky color\n");
 
-    input_update(window.handle, deltaTime, roomW, roomH, roomD);
+  StressScene stress;
+  if (sceneSpec && !stress_create(&stress, sceneSpec, &chair, &planeMesh))
+    return 1;
 
-    renderer_clear((vec4){0.53f, 0.81f, 0.92f, 1.0f}); // sky color
+  SceneView scene = {&planeMesh, floorMat, wallMat, &chair,
+                     hasSky ? &sky : NULL, sceneSpec ? &stress : NULL,
+                     roomW, roomD};
+
+  // edit shaders/ while running, changed programs are rebuilt in place
+  shader_watch_init("shaders");
+
+  if (!shader_finish_pending())
+    fprintf(stderr, "Some shader variants failed, their materials are not drawn\n");
+
+  ShaderCacheStats shaderStats = shader_cache_stats();
+  printf("Startup %.1f ms: %d programs, %d from the binary cache, %d compiled\n",
+         (time_now() - startupBegin) * 1000.0, shaderStats.programs,
+         shaderStats.binaryHits, shaderStats.compiled);
 
-    // camera view
-    mat4 view;
-    camera_get_view_matrix(&camera, view);
-    renderer_set_view(view);
+  FrameGraph graph;
+  framegraph_init(&graph);
 
-    // floor 
-    renderer_draw_quad(&planeMesh, &floorTex, (vec3){0, 0, 0}, roomW, roomD, PLANE_FLOOR);
+  // every frame graph pass becomes a GPU timer zone
+  if (!gputimer_init())
+    fprintf(stderr, "GPU timer queries unavailable\n");
 
-    // front wall
-    renderer_draw_quad(&planeMesh, &wallTex, (vec3){0.0f, 1.5f, -5.0f}, 5.0f, 3.0f, PLANE_WALL_Z);
+  // F4 shows frame times, render counters and pass timings on screen
+  if (!hud_init())
+    fprintf(stderr, "HUD unavailable\n");
 
-    // side wall
-    renderer_draw_quad(&planeMesh, &wallTex, (vec3){3.0f, 1.5f, 0.0f}, 4.0f, 3.0f, PLANE_WALL_X);
+  // movement and animation advance in fixed steps, the camera position and
+  // the stress scene are drawn blended between the last two
+  FixedStep sim;
+  fixedstep_init(&sim, simHz, FIXEDSTEP_DEFAULT_MAX_STEPS);
+  vec3 previousPosition;
+  glm_vec3_copy(camera.Position, previousPosition);
+
+  // from here on the GL context belongs to the render thread
+  RenderState renderState = {&window, &graph, &scene,
+                             benchPath ? &bench : NULL};
+  if (!renderthread_start(&window, framesInFlight, render_frame, &renderState))
+    return 1;
+
+  // startup is not a frame, the simulation would spend its catch-up on it
+  time_update();
+
+  int frame = 0;
+  while (!window_should_close(&window) && !input_replay_finished() &&
+         (maxFrames <= 0 || frame < maxFrames)) {
+    PROFILE_FRAME();
+
+    // waits while the render thread still has every packet, before the frame
+    // starts so the wait is not counted as the frame's work
+    FramePacket *packet = renderthread_acquire();
+    float frameTime = time_update();
+
+    // a bench run steps by its script's dt and a replay by the recorded
+    // ones, so every run draws the same frames
+    float deltaTime = benchPath ? bench.dt : frameTime;
+
+    {
+      PROFILE_ZONE("input");
+      input_begin_frame(window.handle, &deltaTime);
+      if (benchPath)
+        bench_camera(&bench, frame, &camera);
+      else
+        input_update_frame(window.handle);
+    }
+
+    int steps = fixedstep_advance(&sim, deltaTime);
+    {
+      PROFILE_ZONE("simulate");
+      for (int step = 0; step < steps; step++) {
+        glm_vec3_copy(camera.Position, previousPosition);
+        if (!benchPath)
+          input_update(window.handle, (float)sim.step, roomW, roomH, roomD);
+        if (scene.stress)
+          stress_update(scene.stress, (float)sim.step);
+      }
+    }
+
+    {
+      PROFILE_ZONE("build frame");
+      renderer_begin_list(&packet->list);
+
+      float alpha = fixedstep_alpha(&sim);
+      if (scene.stress)
+        stress_interpolate(scene.stress, alpha);
+
+      // camera view, the script places a bench camera every frame itself
+      Camera drawn = camera;
+      if (!benchPath)
+        glm_vec3_lerp(previousPosition, camera.Position, alpha, drawn.Position);
+      mat4 view;
+      camera_get_view_matrix(&drawn, view);
+      renderer_set_view(view);
+      renderer_set_wireframe(input_wireframe());
+
+      queue_scene(&scene);
+      renderer_end_list();
+    }
+
+    // F3 saves the last seconds of CPU zones, open it in chrome://tracing
+    if (input_key_pressed(window.handle, GLFW_KEY_F3)) {
+#ifdef PROFILE
+      profiler_export_chrome("trace.json", 120);
+#else
+      printf("Built without profiling zones, rebuild with make PROFILE=1\n");
+#endif
+    }
+
+    packet->frame = frame;
+    packet->dumpStats = input_key_pressed(window.handle, GLFW_KEY_F2);
+    packet->toggleHud = input_key_pressed(window.handle, GLFW_KEY_F4);
+    packet->screenshotPath =
+        screenshotPath && frame + 1 == maxFrames ? screenshotPath : NULL;
+
+    // the main thread's part of the frame's CPU time, the render thread adds
+    // its own while the next frame is built
+    packet->cpuMs = time_frame_cpu_done();
+    packet->frameMs = frameTime * 1000.0f;
+    packet->times = time_frame_marks();
+    renderthread_submit(packet);
+    frame++;
+
+    window_poll_events(&window);
+
+    {
+      PROFILE_ZONE("frame limit");
+      time_limit_frame();
+    }
+  }
 
-    // draw model
-    mat4 chairModel;
-    glm_mat4_identity(chairModel);
-    glm_translate(chairModel, (vec3){1.0f, 0.0f, -1.0f});
-    glm_scale(chairModel, (vec3){0.5f, 0.5f, 0.5f});
-    renderer_draw_model(&chair, chairModel);
+  // draws what is still in flight, GL is ours again after
+  renderthread_stop();
 
-    window_update(&window);
+  if (benchPath) {
+    bench_write_report(&bench, benchPath, sceneSpec ? sceneSpec : "room",
+                       reportPath, window.width, window.height);
+    bench_destroy(&bench);
   }
+  if (sim.dropped > 0.0)
+    printf("Simulation fell behind, %.2f s dropped past %d steps a frame\n",
+           sim.dropped, sim.maxSteps);
+  if (tracePath)
+    profiler_export_chrome(tracePath, PROFILER_MAX_FRAMES - 1);
+  gldebug_dump(stdout);
 
+  input_shutdown();
+  hud_shutdown();
+  gputimer_shutdown();
+  framegraph_destroy(&graph);
+  if (scene.stress)
+    stress_destroy(scene.stress);
+  if (hasSky)
+    skybox_destroy(&sky);
   mesh_destroy(&planeMesh);
   model_destroy(&chair);
+  texture_destroy(&floorTex);
+  texture_destroy(&wallTex);
   texture_destroy(&cubeTex);
+  material_system_shutdown();
+  shader_cache_shutdown();
   renderer_shutdown();
   window_destroy(&window);
+  jobs_shutdown();
 
   return 0;
 }
@@ -0,0 +1,215 @@
+#include <glad/glad.h>
+#include "gldebug.h"
+#include "material.h"
+#include "stats.h"
+#include <stdio.h>
+#include <string.h>
+
+/*
+
+   the material module should only describe how a surface looks:
+   which shader, which textures, which parameters
+   it should NOT decide draw order or own meshes
+
+   parameters of every material live in one uniform buffer, each material in
+   its own aligned range, so switching material is a single glBindBufferRange
+
+   OWNS: material table, material uniform buffer, texture cache
+
+   input: shaders, texture paths, parameters
+   output: small integer material ids, bound on demand by the renderer
+
+*/
+
+static const char* slotUniforms[MATERIAL_SLOT_COUNT] = {
+    "uTexture",      // albedo
+    "uNormalMap",
+    "uORMMap",
+};
+
+typedef struct {
+    char path[1024]; // file path, or the three packed paths for ORM maps
+    Texture texture;
+} CachedTexture;
+
+static Material materials[MATERIAL_MAX];
+static int materialCount = 0;
+static char surfaceVert[128];
+static char surfaceFrag[128];
+
+static GLuint ubo = 0;
+static GLsizeiptr uboStride = 0;
+
+static CachedTexture textureCache[MATERIAL_MAX_TEXTURES];
+static int textureCacheCount = 0;
+
+// 1x1 fallbacks for empty slots
+static Texture whiteTexture;
+static Texture flatNormalTexture;
+
+static MaterialId boundMaterial = MATERIAL_MAX;
+static GLuint boundTextures[MATERIAL_SLOT_COUNT];
+
+// done on first bind rather than at creation, so creating a material never
+// waits for its variant to finish compiling. A hot reloaded program is a
+// fresh Shader with prepared false, so it is set up again on its next bind
+static void prepare_shader(Shader* shader) {
+    if (shader->prepared) return;
+    shader->prepared = true;
+
+    shader_bind(shader);
+    for (int slot = 0; slot < MATERIAL_SLOT_COUNT; slot++) {
+        int loc = shader_get_uniform(shader, slotUniforms[slot]);
+        if (loc >= 0) glUniform1i(loc, slot);
+    }
+    shader_bind_uniform_block(shader, "Material", MATERIAL_UBO_BINDING);
+}
+
+bool material_system_init(const char* vertPath, const char* fragPath) {
+    snprintf(surfaceVert, sizeof(surfaceVert), "%s", vertPath);
+    snprintf(surfaceFrag, sizeof(surfaceFrag), "%s", fragPath);
+
+    GLint align = 256;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &align);
+    uboStride = ((GLsizeiptr)sizeof(MaterialParams) + align - 1) / align * align;
+
+    glGenBuffers(1, &ubo);
+    glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+    // DYNAMIC: material_update rewrites ranges, drivers warn about SubData on STATIC buffers
+    glBufferData(GL_UNIFORM_BUFFER, uboStride * MATERIAL_MAX, NULL, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    stats_add(STAT_BUFFER_BYTES, uboStride * MATERIAL_MAX);
+    gldebug_label(GL_BUFFER, ubo, "material params");
+
+    static const unsigned char white[3] = { 255, 255, 255 };
+    static const unsigned char flatNormal[3] = { 128, 128, 255 };
+    texture_create(&whiteTexture, 1, 1, 3, white);
+    texture_create(&flatNormalTexture, 1, 1, 3, flatNormal);
+    gldebug_label(GL_TEXTURE, whiteTexture.id, "fallback white");
+    gldebug_label(GL_TEXTURE, flatNormalTexture.id, "fallback flat normal");
+
+    materialCount = 0;
+    textureCacheCount = 0;
+
+    // id 0, used by anything that does not name a material
+    return material_create("default", 0) == MATERIAL_DEFAULT && materials[MATERIAL_DEFAULT].shader;
+}
+
+void material_system_shutdown(void) {
+    for (int i = 0; i < textureCacheCount; i++)
+        texture_destroy(&textureCache[i].texture);
+    textureCacheCount = 0;
+
+    texture_destroy(&whiteTexture);
+    texture_destroy(&flatNormalTexture);
+
+    glDeleteBuffers(1, &ubo);
+    stats_add(STAT_BUFFER_BYTES, -uboStride * MATERIAL_MAX);
+    ubo = 0;
+    materialCount = 0;
+}
+
+MaterialId material_create(const char* name, ShaderFeatures features) {
+    if (materialCount == MATERIAL_MAX) {
+        fprintf(stderr, "Material table full, %s uses the default material\n", name);
+        return MATERIAL_DEFAULT;
+    }
+
+    MaterialId id = (MaterialId)materialCount++;
+    Material* m = &materials[id];
+    memset(m, 0, sizeof(*m));
+    snprintf(m->name, sizeof(m->name), "%s", name ? name : "unnamed");
+    // variants start compiling on first request and are shared by every
+    // material with the same features
+    m->shader = shader_request_variant(surfaceVert, surfaceFrag, features);
+    m->shaderIndex = m->shader ? shader_variant_index(m->shader) : -1;
+    glm_vec4_one(m->params.baseColor);
+    m->params.roughness = 1.0f;
+    m->params.metallic = 0.0f;
+
+    material_invalidate_bindings();
+
+    material_update(id);
+    return id;
+}
+
+Material* material_get(MaterialId id) {
+    return id < materialCount ? &materials[id] : &materials[MATERIAL_DEFAULT];
+}
+
+void material_update(MaterialId id) {
+    if (id >= materialCount) return;
+    glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+    glBufferSubData(GL_UNIFORM_BUFFER, uboStride * id, sizeof(MaterialParams), &materials[id].params);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void material_bind(MaterialId id) {
+    if (id >= materialCount) id = MATERIAL_DEFAULT;
+    if (id == boundMaterial) return;
+
+    const Material* m = &materials[id];
+    if (m->shader) prepare_shader(m->shader);
+
+    for (int slot = 0; slot < MATERIAL_SLOT_COUNT; slot++) {
+        const Texture* tex = m->textures[slot];
+        if (!tex) tex = slot == MATERIAL_SLOT_NORMAL ? &flatNormalTexture : &whiteTexture;
+        if (boundTextures[slot] == tex->id) continue;
+        texture_bind(tex, slot);
+        boundTextures[slot] = tex->id;
+        stats_add(STAT_STATE_CHANGES, 1);
+    }
+
+    glBindBufferRange(GL_UNIFORM_BUFFER, MATERIAL_UBO_BINDING, ubo, uboStride * id, sizeof(MaterialParams));
+    stats_add(STAT_STATE_CHANGES, 1);
+    boundMaterial = id;
+}
+
+void material_invalidate_bindings(void) {
+    boundMaterial = MATERIAL_MAX;
+    memset(boundTextures, 0, sizeof(boundTextures));
+}
+
+static const Texture* find_cached(const char* key) {
+    for (int i = 0; i < textureCacheCount; i++)
+        if (strcmp(textureCache[i].path, key) == 0) return &textureCache[i].texture;
+    return NULL;
+}
+
+static CachedTexture* new_cache_entry(const char* key) {
+    if (textureCacheCount == MATERIAL_MAX_TEXTURES) {
+        fprintf(stderr, "Texture cache full, skipping %s\n", key);
+        return NULL;
+    }
+    CachedTexture* entry = &textureCache[textureCacheCount];
+    snprintf(entry->path, sizeof(entry->path), "%s", key);
+    return entry;
+}
+
+const Texture* material_load_texture(const char* path) {
+    const Texture* cached = find_cached(path);
+    if (cached) return cached;
+
+    CachedTexture* entry = new_cache_entry(path);
+    if (!entry || !texture_load(&entry->texture, path)) return NULL;
+    textureCacheCount++;
+    return &entry->texture;
+}
+
+const Texture* material_load_orm(const char* aoPath, const char* roughnessPath, const char* metalnessPath) {
+    char key[sizeof(((CachedTexture*)0)->path)];
+    snprintf(key, sizeof(key), "orm:%s|%s|%s",
+             aoPath ? aoPath : "", roughnessPath ? roughnessPath : "", metalnessPath ? metalnessPath : "");
+
+    const Texture* cached = find_cached(key);
+    if (cached) return cached;
+
+    CachedTexture* entry = new_cache_entry(key);
+    if (!entry || !texture_pack_orm(&entry->texture, aoPath, roughnessPath, metalnessPath)) return NULL;
+    textureCacheCount++;
+    return &entry->texture;
+}
+
+int material_count(void) {
+    return materialCount;
+}
@@ -1,4 +1,6 @@
+#include "gldebug.h"
 #include "mesh.h"
+#include "stats.h"
 #include <stdlib.h>
 #include <cglm/cglm.h>
 
@@ -39,11 +41,19 @@ static unsigned int cubeIndices[] = {
     0,1,5, 5,4,0  // bottom
 };
 
+static void label_buffers(const Mesh* mesh, const char* name) {
+    gldebug_label(GL_VERTEX_ARRAY, mesh->VAO, name);
+    gldebug_label(GL_BUFFER, mesh->VBO, name);
+    gldebug_label(GL_BUFFER, mesh->EBO, name);
+}
+
 bool mesh_init_cube(Mesh* mesh) {
     if(!mesh) return false;
 
     mesh->vertexCount = 24;
     mesh->indexCount = 36;
+    glm_vec3_fill(mesh->bounds[0], -0.5f);
+    glm_vec3_fill(mesh->bounds[1], 0.5f);
 
     float vertices[] = {
         // positions          // texcoords
@@ -106,13 +116,16 @@ bool mesh_init_cube(Mesh* mesh) {
 
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->EBO);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+    mesh->bufferBytes = sizeof(vertices) + sizeof(indices);
+    stats_add(STAT_BUFFER_BYTES, mesh->bufferBytes);
+    label_buffers(mesh, "cube");
 
     // position
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5*sizeof(float), (void*)0);
     glEnableVertexAttribArray(0);
-    // texcoords
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5*sizeof(float), (void*)(3*sizeof(float)));
-    glEnableVertexAttribArray(1);
+    // texcoords, location 2 like every other mesh
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 5*sizeof(float), (void*)(3*sizeof(float)));
+    glEnableVertexAttribArray(2);
 
     glBindVertexArray(0);
     return true;
@@ -126,14 +139,17 @@ bool mesh_init_plane(Mesh* mesh, float width, float depth, int tiles) {
 
     float w2 = width * 0.5f;
     float d2 = depth * 0.5f;
+    glm_vec3_copy((vec3){-w2, 0.0f, -d2}, mesh->bounds[0]);
+    glm_vec3_copy((vec3){ w2, 0.0f,  d2}, mesh->bounds[1]);
 
     float uvs = (float)tiles;
 
+    // positions, normals (facing +Y), texcoords
     float vertices[] = {
-        -w2, 0.0f, -d2, 0.0f, 0.0f,
-         w2, 0.0f, -d2, uvs, 0.0f,
-         w2, 0.0f,  d2, uvs, uvs,
-        -w2, 0.0f,  d2, 0.0f, uvs
+        -w2, 0.0f, -d2, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f,
+         w2, 0.0f, -d2, 0.0f, 1.0f, 0.0f, uvs, 0.0f,
+         w2, 0.0f,  d2, 0.0f, 1.0f, 0.0f, uvs, uvs,
+        -w2, 0.0f,  d2, 0.0f, 1.0f, 0.0f, 0.0f, uvs
     };
 
     unsigned int indices[] = {0,1,2, 2,3,0};
@@ -149,13 +165,19 @@ bool mesh_init_plane(Mesh* mesh, float width, float depth, int tiles) {
 
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->EBO);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+    mesh->bufferBytes = sizeof(vertices) + sizeof(indices);
+    stats_add(STAT_BUFFER_BYTES, mesh->bufferBytes);
+    label_buffers(mesh, "plane");
 
     // position
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5*sizeof(float), (void*)0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8*sizeof(float), (void*)0);
     glEnableVertexAttribArray(0);
-    // texcoords
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5*sizeof(float), (void*)(3*sizeof(float)));
+    // normal
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8*sizeof(float), (void*)(3*sizeof(float)));
     glEnableVertexAttribArray(1);
+    // texcoords, same location as in models so one shader draws both
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8*sizeof(float), (void*)(6*sizeof(float)));
+    glEnableVertexAttribArray(2);
 
     glBindVertexArray(0);
     return true;
@@ -163,11 +185,19 @@ bool mesh_init_plane(Mesh* mesh, float width, float depth, int tiles) {
 
 void mesh_draw(Mesh* mesh) {
     glBindVertexArray(mesh->VAO);
-    if(mesh->indexCount > 0)
+    mesh_draw_bound(mesh);
+    glBindVertexArray(0);
+}
+
+void mesh_draw_bound(const Mesh* mesh) {
+    stats_add(STAT_DRAW_CALLS, 1);
+    if(mesh->indexCount > 0) {
+        stats_add(STAT_TRIANGLES, mesh->indexCount / 3);
         glDrawElements(GL_TRIANGLES, mesh->indexCount, GL_UNSIGNED_INT, 0);
-    else
+    } else {
+        stats_add(STAT_TRIANGLES, mesh->vertexCount / 3);
         glDrawArrays(GL_TRIANGLES, 0, mesh->vertexCount);
-    glBindVertexArray(0);
+    }
 }
 
 void mesh_destroy(Mesh* mesh) {
@@ -175,4 +205,6 @@ void mesh_destroy(Mesh* mesh) {
     glDeleteBuffers(1, &mesh->VBO);
     if(mesh->indexCount > 0) glDeleteBuffers(1, &mesh->EBO);
     glDeleteVertexArrays(1, &mesh->VAO);
+    stats_add(STAT_BUFFER_BYTES, -mesh->bufferBytes);
+    mesh->bufferBytes = 0;
 }
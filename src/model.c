@@ -1,104 +1,399 @@
+#include "gldebug.h"
+#include "jobs.h"
+#include "loadstats.h"
 #include "model.h"
+#include "profiler.h"
+#include "stats.h"
 #include <assimp/cimport.h>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
+#include <float.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
 #include <glad/glad.h>
+#include <cglm/cglm.h>
 
-bool model_load(Model* model, const char* path) {
-    if (!model) return false;
+#define MODEL_VERTEX_FLOATS 12 // pos + normal + uv + tangent (w = handedness)
 
-    // Import model using Assimp C API
-    const struct aiScene* scene = aiImportFile(path,
-        aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
+// aiTextureTypes to try for each map, in order. OBJ exports put normals in
+// HEIGHT (map_Bump), roughness in SHININESS and metalness in REFLECTION
+typedef enum { MAP_ALBEDO, MAP_NORMAL, MAP_AO, MAP_ROUGHNESS, MAP_METALNESS, MAP_COUNT } MapKind;
 
-    if (!scene) {
-        fprintf(stderr, "Assimp error: %s\n", aiGetErrorString());
-        return false;
+static const enum aiTextureType mapTypes[MAP_COUNT][3] = {
+    [MAP_ALBEDO]    = { aiTextureType_BASE_COLOR, aiTextureType_DIFFUSE, aiTextureType_NONE },
+    [MAP_NORMAL]    = { aiTextureType_NORMAL_CAMERA, aiTextureType_NORMALS, aiTextureType_HEIGHT },
+    [MAP_AO]        = { aiTextureType_AMBIENT_OCCLUSION, aiTextureType_LIGHTMAP, aiTextureType_AMBIENT },
+    [MAP_ROUGHNESS] = { aiTextureType_DIFFUSE_ROUGHNESS, aiTextureType_SHININESS, aiTextureType_NONE },
+    [MAP_METALNESS] = { aiTextureType_METALNESS, aiTextureType_REFLECTION, aiTextureType_NONE },
+};
+
+// texture packs name maps <base>_<Suffix>.png next to the albedo
+static const char* mapSuffixes[MAP_COUNT] = {
+    "_Albedo", "_Normal", "_AO", "_Roughness", "_Metalness",
+};
+
+// a sub-mesh with the material it sorts by, so sorting needs no scene
+typedef struct {
+    unsigned int materialIndex;
+    unsigned int meshIndex;
+} MeshOrder;
+
+// order sub-meshes by material so each material is one contiguous batch
+static int compare_by_material(const void* a, const void* b) {
+    const MeshOrder* oa = a;
+    const MeshOrder* ob = b;
+    if (oa->materialIndex != ob->materialIndex) return oa->materialIndex < ob->materialIndex ? -1 : 1;
+    return oa->meshIndex < ob->meshIndex ? -1 : (oa->meshIndex > ob->meshIndex);
+}
+
+static bool file_exists(const char* path) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return false;
+    fclose(f);
+    return true;
+}
+
+static void resolve_texture_path(const char* dir, const char* rel, char* out, size_t size) {
+    if (rel[0] == '/' || dir[0] == '\0')
+        snprintf(out, size, "%s", rel);
+    else
+        snprintf(out, size, "%s/%s", dir, rel);
+
+    // exporters on windows write backslashes
+    for (char* c = out; *c; c++)
+        if (*c == '\\') *c = '/';
+}
+
+static bool find_map(const struct aiMaterial* aimat, MapKind kind,
+                     const char* dir, char* out, size_t size) {
+    for (int t = 0; t < 3; t++) {
+        enum aiTextureType type = mapTypes[kind][t];
+        if (type == aiTextureType_NONE || aiGetMaterialTextureCount(aimat, type) == 0) continue;
+
+        struct aiString rel;
+        if (aiGetMaterialTexture(aimat, type, 0, &rel, NULL, NULL, NULL, NULL, NULL, NULL) != aiReturn_SUCCESS)
+            continue;
+        resolve_texture_path(dir, rel.data, out, size);
+        if (file_exists(out)) return true;
+    }
+    return false;
+}
+
+// maps the importer does not reference may still sit next to the albedo
+static bool find_sibling_map(const char* albedo, MapKind kind, char* out, size_t size) {
+    const char* suffix = strstr(albedo, mapSuffixes[MAP_ALBEDO]);
+    if (!suffix) return false;
+
+    const char* ext = suffix + strlen(mapSuffixes[MAP_ALBEDO]);
+    snprintf(out, size, "%.*s%s%s", (int)(suffix - albedo), albedo, mapSuffixes[kind], ext);
+    return file_exists(out);
+}
+
+static MaterialId import_material(const struct aiMaterial* aimat, const char* dir, const char* modelPath) {
+    struct aiString name;
+    char label[64];
+    if (aiGetMaterialString(aimat, AI_MATKEY_NAME, &name) == aiReturn_SUCCESS)
+        snprintf(label, sizeof(label), "%s", name.data);
+    else
+        snprintf(label, sizeof(label), "%s", modelPath);
+
+    char paths[MAP_COUNT][512];
+    bool found[MAP_COUNT];
+    for (int kind = 0; kind < MAP_COUNT; kind++)
+        found[kind] = find_map(aimat, kind, dir, paths[kind], sizeof(paths[kind]));
+
+    for (int kind = 0; kind < MAP_COUNT; kind++)
+        if (!found[kind] && found[MAP_ALBEDO])
+            found[kind] = find_sibling_map(paths[MAP_ALBEDO], kind, paths[kind], sizeof(paths[kind]));
+
+    // only materials that have a normal map pay for the TBN
+    ShaderFeatures features = SHADER_FEATURE_PBR;
+    if (found[MAP_NORMAL]) features |= SHADER_FEATURE_NORMAL_MAP;
+
+    MaterialId id = material_create(label, features);
+    Material* mat = material_get(id);
+
+    if (found[MAP_ALBEDO])
+        mat->textures[MATERIAL_SLOT_ALBEDO] = material_load_texture(paths[MAP_ALBEDO]);
+    if (found[MAP_NORMAL])
+        mat->textures[MATERIAL_SLOT_NORMAL] = material_load_texture(paths[MAP_NORMAL]);
+
+    // the three grey maps share one RGB texture, one fetch and a third of the memory
+    if (found[MAP_AO] || found[MAP_ROUGHNESS] || found[MAP_METALNESS]) {
+        mat->textures[MATERIAL_SLOT_ORM] = material_load_orm(found[MAP_AO] ? paths[MAP_AO] : NULL,
+                                                             found[MAP_ROUGHNESS] ? paths[MAP_ROUGHNESS] : NULL,
+                                                             found[MAP_METALNESS] ? paths[MAP_METALNESS] : NULL);
+        // the map holds the real values, a missing metalness channel packs as 0
+        if (mat->textures[MATERIAL_SLOT_ORM]) mat->params.metallic = 1.0f;
     }
 
-    model->meshCount = scene->mNumMeshes;
-    model->meshes = (Mesh*)malloc(sizeof(Mesh) * model->meshCount);
+    // exporters often write a diffuse color next to the map, the map wins
+    struct aiColor4D diffuse;
+    if (!mat->textures[MATERIAL_SLOT_ALBEDO] &&
+        aiGetMaterialColor(aimat, AI_MATKEY_COLOR_DIFFUSE, &diffuse) == aiReturn_SUCCESS) {
+        mat->params.baseColor[0] = diffuse.r;
+        mat->params.baseColor[1] = diffuse.g;
+        mat->params.baseColor[2] = diffuse.b;
+        mat->params.baseColor[3] = diffuse.a;
+    }
 
-    for (unsigned int i = 0; i < scene->mNumMeshes; i++) {
-        struct aiMesh* aimesh = scene->mMeshes[i];
-        Mesh* mesh = &model->meshes[i];
+    material_update(id);
+    return id;
+}
 
-        mesh->vertexCount = aimesh->mNumVertices;
-        mesh->indexCount = aimesh->mNumFaces * 3;
+typedef struct {
+    const struct aiScene* scene;
+    const MeshOrder* order;
+    float* vertices;
+    unsigned int* indices;
+    const GLint* baseVertices;      // per sub-mesh, in order
+    unsigned int* firstIndices;
+    vec3* bounds;                   // min and max per sub-mesh
+} ConvertJob;
 
-        // Allocate arrays for vertices (pos+normal+uv) and indices
-        float* vertices = (float*)malloc(sizeof(float) * mesh->vertexCount * 8);
-        unsigned int* indices = (unsigned int*)malloc(sizeof(unsigned int) * mesh->indexCount);
+// sub-meshes [begin, end) into the packed arrays, each writes only its own range
+static void convert_meshes(int begin, int end, void* user) {
+    const ConvertJob* job = user;
+    for (int i = begin; i < end; i++) {
+        const struct aiMesh* aimesh = job->scene->mMeshes[job->order[i].meshIndex];
+        float* dst = job->vertices + (size_t)job->baseVertices[i] * MODEL_VERTEX_FLOATS;
+        unsigned int firstIndex = job->firstIndices[i];
+        vec3* bounds = &job->bounds[i * 2];
+        glm_vec3_fill(bounds[0], FLT_MAX);
+        glm_vec3_fill(bounds[1], -FLT_MAX);
 
-        for (unsigned int v = 0; v < mesh->vertexCount; v++) {
-            vertices[v*8 +0] = aimesh->mVertices[v].x;
-            vertices[v*8 +1] = aimesh->mVertices[v].y;
-            vertices[v*8 +2] = aimesh->mVertices[v].z;
+        for (unsigned int v = 0; v < aimesh->mNumVertices; v++) {
+            float* out = dst + (size_t)v * MODEL_VERTEX_FLOATS;
+            out[0] = aimesh->mVertices[v].x;
+            out[1] = aimesh->mVertices[v].y;
+            out[2] = aimesh->mVertices[v].z;
+            glm_vec3_minv(bounds[0], out, bounds[0]);
+            glm_vec3_maxv(bounds[1], out, bounds[1]);
 
             if (aimesh->mNormals) {
-                vertices[v*8 +3] = aimesh->mNormals[v].x;
-                vertices[v*8 +4] = aimesh->mNormals[v].y;
-                vertices[v*8 +5] = aimesh->mNormals[v].z;
+                out[3] = aimesh->mNormals[v].x;
+                out[4] = aimesh->mNormals[v].y;
+                out[5] = aimesh->mNormals[v].z;
             } else {
-                vertices[v*8 +3] = vertices[v*8 +4] = vertices[v*8 +5] = 0.0f;
+                out[3] = out[4] = out[5] = 0.0f;
             }
 
             if (aimesh->mTextureCoords[0]) {
-                vertices[v*8 +6] = aimesh->mTextureCoords[0][v].x;
-                vertices[v*8 +7] = aimesh->mTextureCoords[0][v].y;
+                out[6] = aimesh->mTextureCoords[0][v].x;
+                out[7] = aimesh->mTextureCoords[0][v].y;
+            } else {
+                out[6] = out[7] = 0.0f;
+            }
+
+            // tangent from aiProcess_CalcTangentSpace, w flips the shader's
+            // cross(N, T) where the UVs are mirrored
+            if (aimesh->mTangents && aimesh->mBitangents && aimesh->mNormals) {
+                vec3 n = { out[3], out[4], out[5] };
+                vec3 t = { aimesh->mTangents[v].x, aimesh->mTangents[v].y, aimesh->mTangents[v].z };
+                vec3 b = { aimesh->mBitangents[v].x, aimesh->mBitangents[v].y, aimesh->mBitangents[v].z };
+                vec3 nxt;
+                glm_vec3_cross(n, t, nxt);
+                out[8] = t[0];
+                out[9] = t[1];
+                out[10] = t[2];
+                out[11] = glm_vec3_dot(nxt, b) < 0.0f ? -1.0f : 1.0f;
             } else {
-                vertices[v*8 +6] = vertices[v*8 +7] = 0.0f;
+                out[8] = 1.0f;
+                out[9] = out[10] = 0.0f;
+                out[11] = 1.0f;
             }
         }
 
+        // indices stay local to the sub-mesh, baseVertex offsets them at draw time
         for (unsigned int f = 0; f < aimesh->mNumFaces; f++) {
-            indices[f*3 +0] = aimesh->mFaces[f].mIndices[0];
-            indices[f*3 +1] = aimesh->mFaces[f].mIndices[1];
-            indices[f*3 +2] = aimesh->mFaces[f].mIndices[2];
+            job->indices[firstIndex + f*3 +0] = aimesh->mFaces[f].mIndices[0];
+            job->indices[firstIndex + f*3 +1] = aimesh->mFaces[f].mIndices[1];
+            job->indices[firstIndex + f*3 +2] = aimesh->mFaces[f].mIndices[2];
         }
+    }
+}
+
+bool model_load(Model* model, const char* path) {
+    PROFILE_ZONE("model_load");
+    if (!model) return false;
+    memset(model, 0, sizeof(*model));
+    loadstats_begin("model", path);
+    struct stat file;
+    if (stat(path, &file) == 0) loadstats_bytes(file.st_size);
+
+    // Import model using Assimp C API
+    const struct aiScene* scene = aiImportFile(path,
+        aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
+
+    // assimp reads the file itself, decode includes the read
+    loadstats_stage(LOAD_DECODE);
+    if (!scene) {
+        fprintf(stderr, "Assimp error: %s\n", aiGetErrorString());
+        loadstats_end();
+        return false;
+    }
+
+    char dir[512];
+    const char* slash = strrchr(path, '/');
+    snprintf(dir, sizeof(dir), "%.*s", slash ? (int)(slash - path) : 0, path);
+
+    MaterialId* materials = (MaterialId*)malloc(sizeof(MaterialId) * (scene->mNumMaterials + 1));
+    for (unsigned int i = 0; i < scene->mNumMaterials; i++)
+        materials[i] = import_material(scene->mMaterials[i], dir, path);
+
+    // nothing to draw, and nothing for model_destroy to delete
+    unsigned int meshCount = scene->mNumMeshes;
+    if (meshCount == 0) {
+        fprintf(stderr, "Model %s has no meshes\n", path);
+        free(materials);
+        aiReleaseImport(scene);
+        loadstats_end();
+        return true;
+    }
 
-        // Upload to OpenGL
-        glGenVertexArrays(1, &mesh->VAO);
-        glGenBuffers(1, &mesh->VBO);
-        glGenBuffers(1, &mesh->EBO);
+    MeshOrder* order = (MeshOrder*)malloc(sizeof(MeshOrder) * meshCount);
+    unsigned int totalVertices = 0, totalIndices = 0;
+    for (unsigned int i = 0; i < meshCount; i++) {
+        order[i].materialIndex = scene->mMeshes[i]->mMaterialIndex;
+        order[i].meshIndex = i;
+        totalVertices += scene->mMeshes[i]->mNumVertices;
+        totalIndices += scene->mMeshes[i]->mNumFaces * 3;
+    }
+    qsort(order, meshCount, sizeof(MeshOrder), compare_by_material);
+
+    model->subMeshCount = meshCount;
+    model->drawCounts = (GLsizei*)malloc(sizeof(GLsizei) * meshCount);
+    model->drawOffsets = (const void**)malloc(sizeof(void*) * meshCount);
+    model->drawBaseVertices = (GLint*)malloc(sizeof(GLint) * meshCount);
+    model->batches = (ModelBatch*)malloc(sizeof(ModelBatch) * meshCount);
 
-        glBindVertexArray(mesh->VAO);
+    // Allocate arrays for all vertices (pos+normal+uv) and indices
+    float* vertices = (float*)malloc(sizeof(float) * totalVertices * MODEL_VERTEX_FLOATS);
+    unsigned int* indices = (unsigned int*)malloc(sizeof(unsigned int) * totalIndices);
 
-        glBindBuffer(GL_ARRAY_BUFFER, mesh->VBO);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(float)*mesh->vertexCount*8, vertices, GL_STATIC_DRAW);
+    Mesh* mesh = &model->mesh;
+    ConvertJob convert = {
+        .scene = scene,
+        .order = order,
+        .vertices = vertices,
+        .indices = indices,
+        .baseVertices = model->drawBaseVertices,
+        .firstIndices = (unsigned int*)malloc(sizeof(unsigned int) * meshCount),
+        .bounds = (vec3*)malloc(sizeof(vec3) * 2 * meshCount),
+    };
 
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int)*mesh->indexCount, indices, GL_STATIC_DRAW);
+    // ranges and batches first, every sub-mesh then converts into its own range
+    unsigned int baseVertex = 0, firstIndex = 0;
+    for (unsigned int i = 0; i < meshCount; i++) {
+        struct aiMesh* aimesh = scene->mMeshes[order[i].meshIndex];
+        convert.firstIndices[i] = firstIndex;
 
-        // vertex attributes: position (0), normal (1), uv (2)
-        glVertexAttribPointer(0,3,GL_FLOAT,GL_FALSE,8*sizeof(float),(void*)0);
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(1,3,GL_FLOAT,GL_FALSE,8*sizeof(float),(void*)(3*sizeof(float)));
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(2,2,GL_FLOAT,GL_FALSE,8*sizeof(float),(void*)(6*sizeof(float)));
-        glEnableVertexAttribArray(2);
+        model->drawCounts[i] = (GLsizei)(aimesh->mNumFaces * 3);
+        model->drawOffsets[i] = (const void*)(sizeof(unsigned int) * (size_t)firstIndex);
+        model->drawBaseVertices[i] = (GLint)baseVertex;
 
-        glBindVertexArray(0);
+        if (model->batchCount == 0 ||
+            model->batches[model->batchCount - 1].materialIndex != aimesh->mMaterialIndex) {
+            ModelBatch* batch = &model->batches[model->batchCount++];
+            batch->first = i;
+            batch->count = 0;
+            batch->indexCount = 0;
+            batch->materialIndex = aimesh->mMaterialIndex;
+            batch->material = aimesh->mMaterialIndex < scene->mNumMaterials
+                ? materials[aimesh->mMaterialIndex] : MATERIAL_DEFAULT;
+        }
+        model->batches[model->batchCount - 1].count++;
+        model->batches[model->batchCount - 1].indexCount += model->drawCounts[i];
 
-        free(vertices);
-        free(indices);
+        baseVertex += aimesh->mNumVertices;
+        firstIndex += aimesh->mNumFaces * 3;
     }
 
+    jobs_parallel_for((int)meshCount, 1, convert_meshes, &convert);
+
+    glm_vec3_fill(mesh->bounds[0], FLT_MAX);
+    glm_vec3_fill(mesh->bounds[1], -FLT_MAX);
+    for (unsigned int i = 0; i < meshCount; i++) {
+        glm_vec3_minv(mesh->bounds[0], convert.bounds[i * 2], mesh->bounds[0]);
+        glm_vec3_maxv(mesh->bounds[1], convert.bounds[i * 2 + 1], mesh->bounds[1]);
+    }
+    free(convert.firstIndices);
+    free(convert.bounds);
+
+    loadstats_stage(LOAD_CONVERT);
+
+    // Upload to OpenGL, one buffer pair for the whole model
+    mesh->vertexCount = (int)totalVertices;
+    mesh->indexCount = (int)totalIndices;
+
+    glGenVertexArrays(1, &mesh->VAO);
+    glGenBuffers(1, &mesh->VBO);
+    glGenBuffers(1, &mesh->EBO);
+
+    glBindVertexArray(mesh->VAO);
+
+    glBindBuffer(GL_ARRAY_BUFFER, mesh->VBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(float)*totalVertices*MODEL_VERTEX_FLOATS, vertices, GL_STATIC_DRAW);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int)*totalIndices, indices, GL_STATIC_DRAW);
+    loadstats_stage(LOAD_UPLOAD);
+    mesh->bufferBytes = sizeof(float)*totalVertices*MODEL_VERTEX_FLOATS + sizeof(unsigned int)*totalIndices;
+    stats_add(STAT_BUFFER_BYTES, mesh->bufferBytes);
+    gldebug_label(GL_VERTEX_ARRAY, mesh->VAO, path);
+    gldebug_label(GL_BUFFER, mesh->VBO, path);
+    gldebug_label(GL_BUFFER, mesh->EBO, path);
+
+    // vertex attributes: position (0), normal (1), uv (2), tangent (3)
+    GLsizei stride = MODEL_VERTEX_FLOATS*sizeof(float);
+    glVertexAttribPointer(0,3,GL_FLOAT,GL_FALSE,stride,(void*)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1,3,GL_FLOAT,GL_FALSE,stride,(void*)(3*sizeof(float)));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(2,2,GL_FLOAT,GL_FALSE,stride,(void*)(6*sizeof(float)));
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(3,4,GL_FLOAT,GL_FALSE,stride,(void*)(8*sizeof(float)));
+    glEnableVertexAttribArray(3);
+
+    glBindVertexArray(0);
+
+    free(vertices);
+    free(indices);
+    free(order);
+    free(materials);
+
     aiReleaseImport(scene);
+    loadstats_end();
     return true;
 }
 
+void model_draw_batch(const Model* model, int batch) {
+    const ModelBatch* b = &model->batches[batch];
+    stats_add(STAT_DRAW_CALLS, 1);
+    stats_add(STAT_TRIANGLES, b->indexCount / 3);
+    glMultiDrawElementsBaseVertex(GL_TRIANGLES,
+                                  model->drawCounts + b->first,
+                                  GL_UNSIGNED_INT,
+                                  (const void* const*)(model->drawOffsets + b->first),
+                                  b->count,
+                                  model->drawBaseVertices + b->first);
+}
+
 void model_draw(Model* model) {
-    for (int i = 0; i < model->meshCount; i++) {
-        mesh_draw(&model->meshes[i]);
+    glBindVertexArray(model->mesh.VAO);
+    for (int i = 0; i < model->batchCount; i++) {
+        model_draw_batch(model, i);
     }
+    glBindVertexArray(0);
 }
 
 void model_destroy(Model* model) {
-    for (int i = 0; i < model->meshCount; i++) {
-        mesh_destroy(&model->meshes[i]);
-    }
-    free(model->meshes);
+    if (model->subMeshCount > 0) mesh_destroy(&model->mesh);
+    free(model->drawCounts);
+    free(model->drawOffsets);
+    free(model->drawBaseVertices);
+    free(model->batches);
+    memset(model, 0, sizeof(*model));
 }
@@ -0,0 +1,197 @@
+#define _POSIX_C_SOURCE 200809L // clock_gettime
+#include "profiler.h"
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define PROFILER_USE_TSC 1
+#endif
+
+/*
+
+   the profiler module should only record when CPU zones start and end
+   it should NOT decide what to measure, callers place PROFILE_ZONE markers
+
+   each thread writes its own ring of events with no locks: only the owner
+   thread writes, and it publishes its head with a release store that the
+   exporter reads with acquire. timestamps are raw TSC ticks where available
+   (a few ns to read) and are converted to time only when exporting
+
+   the exporter copies a ring while its owner keeps writing, the oldest
+   entries being the next overwritten. after copying it reads the head
+   again and drops every entry the owner may have reached since, plus
+   PROFILER_EXPORT_MARGIN for writes not yet published
+
+   OWNS: per-thread event rings, frame marks
+
+   input: zone begin/end from any thread
+   output: Chrome trace JSON of the last N frames
+
+*/
+
+#define PROFILER_EXPORT_MARGIN 1024 // events behind a live head treated as possibly overwritten
+
+typedef struct {
+    const char* name;
+    uint64_t start, end;
+} ProfileEvent;
+
+typedef struct {
+    ProfileEvent events[PROFILER_EVENTS_PER_THREAD];
+    atomic_uint_fast64_t head;   // total events written, index = head % capacity
+    const char* name;
+    int tid;
+} ProfileThread;
+
+static ProfileThread threads[PROFILER_MAX_THREADS];
+static atomic_int threadCount = 0;
+static _Thread_local ProfileThread* self = NULL;
+
+static uint64_t frameMarks[PROFILER_MAX_FRAMES];
+static atomic_uint_fast64_t frameCount = 0;
+
+// tick -> ns calibration: both clocks sampled at init and again at export
+static uint64_t baseTicks;
+static uint64_t baseNs;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static inline uint64_t now_ticks(void) {
+#ifdef PROFILER_USE_TSC
+    return __rdtsc();
+#else
+    return now_ns();
+#endif
+}
+
+void profiler_init(void) {
+    baseNs = now_ns();
+    baseTicks = now_ticks();
+}
+
+static ProfileThread* this_thread(void) {
+    if (self) return self;
+
+    int index = atomic_fetch_add(&threadCount, 1);
+    if (index >= PROFILER_MAX_THREADS) {
+        atomic_fetch_sub(&threadCount, 1);
+        return NULL;
+    }
+    self = &threads[index];
+    self->tid = index;
+    return self;
+}
+
+ProfileZone profiler_zone_begin(const char* name) {
+    ProfileZone zone = { name, now_ticks() };
+    return zone;
+}
+
+void profiler_zone_end(ProfileZone* zone) {
+    uint64_t end = now_ticks();
+    ProfileThread* t = this_thread();
+    if (!t) return;
+
+    uint64_t head = atomic_load_explicit(&t->head, memory_order_relaxed);
+    ProfileEvent* e = &t->events[head % PROFILER_EVENTS_PER_THREAD];
+    e->name = zone->name;
+    e->start = zone->start;
+    e->end = end;
+    atomic_store_explicit(&t->head, head + 1, memory_order_release);
+}
+
+void profiler_frame_mark(void) {
+    uint64_t count = atomic_load_explicit(&frameCount, memory_order_relaxed);
+    frameMarks[count % PROFILER_MAX_FRAMES] = now_ticks();
+    atomic_store_explicit(&frameCount, count + 1, memory_order_release);
+}
+
+void profiler_thread_name(const char* name) {
+    ProfileThread* t = this_thread();
+    if (t) t->name = name;
+}
+
+// JSON strings need quotes and backslashes escaped, zone names are literals
+static void write_json_string(FILE* f, const char* s) {
+    fputc('"', f);
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\') fputc('\\', f);
+        fputc(*s, f);
+    }
+    fputc('"', f);
+}
+
+bool profiler_export_chrome(const char* path, int frames) {
+    uint64_t marks = atomic_load_explicit(&frameCount, memory_order_acquire);
+    if (frames > PROFILER_MAX_FRAMES - 1) frames = PROFILER_MAX_FRAMES - 1;
+    if ((uint64_t)frames > marks) frames = (int)marks;
+
+    // everything after the mark that started the oldest wanted frame
+    uint64_t from = frames > 0 ? frameMarks[(marks - (uint64_t)frames) % PROFILER_MAX_FRAMES] : 0;
+
+    uint64_t nowNs = now_ns();
+    uint64_t nowTicks = now_ticks();
+    double nsPerTick = nowTicks > baseTicks ? (double)(nowNs - baseNs) / (double)(nowTicks - baseTicks) : 1.0;
+
+    ProfileEvent* copy = malloc(sizeof(ProfileEvent) * PROFILER_EVENTS_PER_THREAD);
+    FILE* f = copy ? fopen(path, "w") : NULL;
+    if (!f) {
+        fprintf(stderr, "Cannot write trace %s\n", path);
+        free(copy);
+        return false;
+    }
+
+    fprintf(f, "{\"traceEvents\":[\n");
+    bool first = true;
+    int events = 0;
+    int count = atomic_load(&threadCount);
+    for (int i = 0; i < count && i < PROFILER_MAX_THREADS; i++) {
+        ProfileThread* t = &threads[i];
+        if (t->name) {
+            fprintf(f, "%s{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":",
+                    first ? "" : ",\n", t->tid);
+            write_json_string(f, t->name);
+            fprintf(f, "}}");
+            first = false;
+        }
+
+        uint64_t head = atomic_load_explicit(&t->head, memory_order_acquire);
+        uint64_t begin = head > PROFILER_EVENTS_PER_THREAD ? head - PROFILER_EVENTS_PER_THREAD : 0;
+        for (uint64_t n = begin; n < head; n++)
+            copy[n % PROFILER_EVENTS_PER_THREAD] = t->events[n % PROFILER_EVENTS_PER_THREAD];
+
+        // the copies are read before the head is, whatever the owner wrote
+        // meanwhile starts at the ring's oldest entries
+        atomic_thread_fence(memory_order_acquire);
+        uint64_t now = atomic_load_explicit(&t->head, memory_order_relaxed);
+        uint64_t reached = now + PROFILER_EXPORT_MARGIN;
+        if (reached > PROFILER_EVENTS_PER_THREAD && reached - PROFILER_EVENTS_PER_THREAD > begin)
+            begin = reached - PROFILER_EVENTS_PER_THREAD;
+
+        for (uint64_t n = begin; n < head; n++) {
+            const ProfileEvent* e = &copy[n % PROFILER_EVENTS_PER_THREAD];
+            if (e->start < from) continue;
+
+            double ts = (double)(e->start - baseTicks) * nsPerTick / 1000.0;
+            double dur = (double)(e->end - e->start) * nsPerTick / 1000.0;
+            fprintf(f, "%s{\"ph\":\"X\",\"name\":", first ? "" : ",\n");
+            write_json_string(f, e->name);
+            fprintf(f, ",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}", t->tid, ts, dur);
+            first = false;
+            events++;
+        }
+    }
+    fprintf(f, "\n],\"displayTimeUnit\":\"ms\"}\n");
+    fclose(f);
+    free(copy);
+
+    printf("Wrote %d zones from %d frames to %s\n", events, frames, path);
+    return true;
+}
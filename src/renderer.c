@@ -2,12 +2,20 @@
 #include <glad/glad.h>
 // aa
 #include "camera.h"
+#include "gldebug.h"
+#include "jobs.h"
 #include "mesh.h"
+#include "material.h"
+#include "profiler.h"
 #include "renderer.h"
 #include "shader.h"
+#include "stats.h"
 #include "texture.h"
+#include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 /*
 
@@ -15,6 +23,12 @@
    if this file is deciding things instead of executing things it is doing too
    much
 
+   draws are queued into a RenderList and culled against the view frustum
+   without GL, on whichever thread builds the frame. the thread with the GL
+   context sorts the list by (shader, material, depth), program ids being
+   its own, and executes it in renderer_flush so consecutive draws share as
+   much state as possible
+
    OWNS OPENGL STATE
 
    input: meshes, shaders, materials, transforms, camera, lights etc
@@ -22,20 +36,50 @@
 
 */
 
-static Shader *activeShader = NULL;
+// what the next list starts from, on the building side
 static mat4 projection;
-static mat4 view;
 static vec3 lightPos;
+static PointLight lights[RENDERER_MAX_POINT_LIGHTS];
+static int lightCount = 0;
+static bool wireframe = false;
+
+static RenderList *building = NULL;
+static RenderList *executing = NULL;
+static bool wireframeApplied = false;
+
+// std140 Lights block: the count, then the array
+typedef struct {
+  int32_t count[4];
+  PointLight lights[RENDERER_MAX_POINT_LIGHTS];
+} LightsBlock;
+
+static GLuint lightsUBO = 0;
 
 bool renderer_init(void) {
   glEnable(GL_DEPTH_TEST);
   glDisable(GL_CULL_FACE);
   glCullFace(GL_BACK);
+
+  // starts with no point lights, the block stays bound for the whole run
+  LightsBlock empty = {0};
+  glGenBuffers(1, &lightsUBO);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, lightsUBO);
+  glBufferData(GL_COPY_WRITE_BUFFER, sizeof(LightsBlock), &empty,
+               GL_DYNAMIC_DRAW);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  glBindBufferBase(GL_UNIFORM_BUFFER, RENDERER_LIGHTS_UBO_BINDING, lightsUBO);
+  gldebug_label(GL_BUFFER, lightsUBO, "point lights");
+  stats_add(STAT_BUFFER_BYTES, sizeof(LightsBlock));
   return true;
 }
 
 void renderer_shutdown(void) {
-  // todo
+  if (lightsUBO) {
+    glDeleteBuffers(1, &lightsUBO);
+    lightsUBO = 0;
+    stats_add(STAT_BUFFER_BYTES, -(int64_t)sizeof(LightsBlock));
+  }
+  executing = NULL;
 }
 
 void renderer_clear(vec4 color) {
@@ -43,75 +87,161 @@ void renderer_clear(vec4 color) {
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 }
 
-void renderer_set_shader(Shader *shader) {
-  activeShader = shader;
-  shader_bind(shader);
+void renderer_clear_depth(void) { glClear(GL_DEPTH_BUFFER_BIT); }
+
+void renderer_begin_list(RenderList *list) {
+  building = list;
+  glm_mat4_copy(projection, list->projection);
+  glm_mat4_identity(list->view);
+  glm_vec3_copy(lightPos, list->lightPos);
+  memcpy(list->lights, lights, sizeof(PointLight) * lightCount);
+  list->lightCount = lightCount;
+  list->wireframe = wireframe;
+  list->drawCount = 0;
+  list->culled = 0;
+}
+
+void renderer_list_free(RenderList *list) {
+  free(list->draws);
+  free(list->visible);
+  list->draws = NULL;
+  list->visible = NULL;
+  list->drawCount = list->drawCapacity = 0;
 }
 
 void renderer_set_projection(mat4 proj) {
-  if (!activeShader)
-    return;
-  shader_bind(activeShader);
-  int loc = shader_get_uniform(activeShader, "projection");
-  glUniformMatrix4fv(loc, 1, GL_FALSE, (float *)proj);
   glm_mat4_copy(proj, projection);
+  if (building)
+    glm_mat4_copy(proj, building->projection);
 }
 
 void renderer_set_view(mat4 v) {
-  if (!activeShader)
-    return;
-  shader_bind(activeShader);
-  int loc = shader_get_uniform(activeShader, "view");
-  glUniformMatrix4fv(loc, 1, GL_FALSE, (float *)v);
-  glm_mat4_copy(v, view);
+  if (building)
+    glm_mat4_copy(v, building->view);
 }
 
 void renderer_set_light(vec3 pos) {
-  lightPos[0] = pos[0];
-  lightPos[1] = pos[1];
-  lightPos[2] = pos[2];
-  if (!activeShader)
-    return;
-  shader_bind(activeShader);
-  int loc = shader_get_uniform(activeShader, "lightPos");
-  glUniform3fv(loc, 1, lightPos);
+  glm_vec3_copy(pos, lightPos);
+  if (building)
+    glm_vec3_copy(pos, building->lightPos);
 }
 
-void renderer_draw_mesh(const Mesh *mesh, const Texture *tex, mat4 model) {
-  if (!activeShader)
-    return;
+void renderer_set_point_lights(const PointLight *newLights, int count) {
+  if (count > RENDERER_MAX_POINT_LIGHTS)
+    count = RENDERER_MAX_POINT_LIGHTS;
+  if (count < 0)
+    count = 0;
+
+  if (count > 0)
+    memcpy(lights, newLights, sizeof(PointLight) * count);
+  lightCount = count;
+  if (building) {
+    memcpy(building->lights, lights, sizeof(PointLight) * count);
+    building->lightCount = count;
+  }
+}
 
-  shader_bind(activeShader);
+void renderer_set_wireframe(bool enabled) {
+  wireframe = enabled;
+  if (building)
+    building->wireframe = enabled;
+}
 
-  // set uniforms
-  int modelLoc = shader_get_uniform(activeShader, "model");
-  glUniformMatrix4fv(modelLoc, 1, GL_FALSE, (float *)model);
+void renderer_use_list(RenderList *list) {
+  executing = list;
 
-  // bind texture
-  if (tex)
-    texture_bind((Texture *)tex, 0);
+  // only the count and the lights in use are uploaded
+  int32_t header[4] = {list->lightCount, 0, 0, 0};
+  glBindBuffer(GL_COPY_WRITE_BUFFER, lightsUBO);
+  glBufferSubData(GL_COPY_WRITE_BUFFER, 0, sizeof(header), header);
+  if (list->lightCount > 0)
+    glBufferSubData(GL_COPY_WRITE_BUFFER, offsetof(LightsBlock, lights),
+                    sizeof(PointLight) * list->lightCount, list->lights);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
 
-  // draw
-  mesh_draw((Mesh *)mesh);
+  if (list->wireframe != wireframeApplied) {
+    wireframeApplied = list->wireframe;
+    glPolygonMode(GL_FRONT_AND_BACK, wireframeApplied ? GL_LINE : GL_FILL);
+  }
 
-  // unbind texture
-  if (tex)
-    texture_unbind();
+  // culled where the list was built, counted with the frame that draws it
+  stats_add(STAT_OBJECTS_VISIBLE, list->drawCount);
+  stats_add(STAT_OBJECTS_CULLED, list->culled);
 }
 
-void renderer_draw_model(const Model *model, mat4 modelMatrix) {
-  if (!activeShader)
-    return;
+// program | material | depth, most expensive state change in the high bits.
+// The program is the variant's cache slot: hot reload rewrites the GL id on
+// the render thread, the slot never changes
+static uint64_t sort_key(const RenderList *list, MaterialId material,
+                         mat4 transform) {
+  const Material *m = material_get(material);
+  uint64_t program = (uint64_t)(m->shaderIndex + 1) & 0xFFFF;
 
-  shader_bind(activeShader);
+  // view space distance of the origin, front to back for early-Z
+  vec3 origin = {transform[3][0], transform[3][1], transform[3][2]};
+  vec3 viewPos;
+  glm_mat4_mulv3((vec4 *)list->view, origin, 1.0f, viewPos);
+  float depth = viewPos[2] < 0.0f ? -viewPos[2] : 0.0f;
 
-  int modelLoc = shader_get_uniform(activeShader, "model");
-  glUniformMatrix4fv(modelLoc, 1, GL_FALSE, (float *)modelMatrix);
+  // positive floats order the same as their bit patterns
+  uint32_t depthBits;
+  memcpy(&depthBits, &depth, sizeof(depthBits));
 
-  model_draw((Model *)model);
+  return program << 48 | (uint64_t)material << 32 | depthBits;
 }
 
-void renderer_draw_quad(const Mesh *mesh, const Texture *tex, vec3 pos,
+static DrawCommand *push_command(MaterialId material, mat4 transform) {
+  RenderList *list = building;
+  if (!list) {
+    fprintf(stderr, "Draw outside renderer_begin_list\n");
+    return NULL;
+  }
+
+  if (list->drawCount == list->drawCapacity) {
+    int capacity = list->drawCapacity ? list->drawCapacity * 2 : 64;
+    DrawCommand *grown = realloc(list->draws, sizeof(DrawCommand) * capacity);
+    if (!grown) {
+      fprintf(stderr, "Draw queue allocation failed\n");
+      return NULL;
+    }
+    list->draws = grown;
+    unsigned char *visible = realloc(list->visible, capacity);
+    if (!visible) {
+      fprintf(stderr, "Draw queue allocation failed\n");
+      return NULL;
+    }
+    list->visible = visible;
+    list->drawCapacity = capacity;
+  }
+
+  DrawCommand *cmd = &list->draws[list->drawCount++];
+  cmd->key = 0;
+  cmd->material = material;
+  glm_mat4_copy(transform, cmd->transform);
+  return cmd;
+}
+
+void renderer_draw_mesh(const Mesh *mesh, MaterialId material, mat4 model) {
+  DrawCommand *cmd = push_command(material, model);
+  if (!cmd)
+    return;
+  cmd->mesh = mesh;
+  cmd->model = NULL;
+  cmd->batch = 0;
+}
+
+void renderer_draw_model(const Model *model, mat4 modelMatrix) {
+  for (int i = 0; i < model->batchCount; i++) {
+    DrawCommand *cmd = push_command(model->batches[i].material, modelMatrix);
+    if (!cmd)
+      return;
+    cmd->mesh = &model->mesh;
+    cmd->model = model;
+    cmd->batch = i;
+  }
+}
+
+void renderer_draw_quad(const Mesh *mesh, MaterialId material, vec3 pos,
                         float width, float height, PlaneType type) {
   mat4 model;
   glm_mat4_identity(model);
@@ -133,5 +263,187 @@ void renderer_draw_quad(const Mesh *mesh, const Texture *tex, vec3 pos,
     glm_scale(model, (vec3){width, 1.0f, height});
   }
 
-  renderer_draw_mesh(mesh, tex, model);
+  renderer_draw_mesh(mesh, material, model);
+}
+
+static int compare_commands(const void *a, const void *b) {
+  uint64_t ka = ((const DrawCommand *)a)->key;
+  uint64_t kb = ((const DrawCommand *)b)->key;
+  return ka < kb ? -1 : (ka > kb);
+}
+
+// drop commands whose world space bounds are outside the view frustum
+typedef struct {
+  const RenderList *list;
+  vec4 planes[6];
+} CullJob;
+
+static void cull_range(int begin, int end, void *user) {
+  CullJob *job = user;
+  const DrawCommand *draws = job->list->draws;
+  for (int i = begin; i < end; i++) {
+    vec3 local[2], box[2];
+    glm_vec3_copy((float *)draws[i].mesh->bounds[0], local[0]);
+    glm_vec3_copy((float *)draws[i].mesh->bounds[1], local[1]);
+    glm_aabb_transform(local, (vec4 *)draws[i].transform, box);
+    job->list->visible[i] = glm_aabb_frustum(box, job->planes);
+  }
+}
+
+void renderer_end_list(void) {
+  PROFILE_ZONE("culling");
+  RenderList *list = building;
+  building = NULL;
+  if (!list)
+    return;
+
+  CullJob job = {.list = list};
+  mat4 viewProj;
+  glm_mat4_mul(list->projection, list->view, viewProj);
+  glm_frustum_planes(viewProj, job.planes);
+
+  // the tests split across threads, compacting stays in order on this one
+  jobs_parallel_for(list->drawCount, 256, cull_range, &job);
+
+  DrawCommand *draws = list->draws;
+  int kept = 0;
+  for (int i = 0; i < list->drawCount; i++)
+    if (list->visible[i])
+      draws[kept++] = draws[i];
+  list->culled = list->drawCount - kept;
+  list->drawCount = kept;
+}
+
+void renderer_flush(void) {
+  RenderList *list = executing;
+  if (!list)
+    return;
+
+  {
+    PROFILE_ZONE("sort draws");
+    for (int i = 0; i < list->drawCount; i++)
+      list->draws[i].key =
+          sort_key(list, list->draws[i].material, list->draws[i].transform);
+    qsort(list->draws, list->drawCount, sizeof(DrawCommand),
+          compare_commands);
+  }
+
+  PROFILE_ZONE("draw submission");
+
+  // someone else may have touched programs and textures since the last flush
+  material_invalidate_bindings();
+  const Shader *boundShader = NULL;
+  GLuint boundVAO = 0;
+  MaterialId boundMaterial = MATERIAL_MAX;
+
+  for (int i = 0; i < list->drawCount; i++) {
+    const DrawCommand *cmd = &list->draws[i];
+    const Material *m = material_get(cmd->material);
+    // no shader, or a variant that failed to link
+    if (!m->shader || !m->shader->id)
+      continue;
+
+    // with debug output on, driver messages name the mesh and material drawn
+    char group[256];
+    if (gldebug_enabled()) {
+      const char *meshLabel = gldebug_object_label(GL_VERTEX_ARRAY, cmd->mesh->VAO);
+      snprintf(group, sizeof(group), "draw %s, material %s",
+               meshLabel ? meshLabel : "unlabelled mesh", m->name);
+      gldebug_push_group(group);
+    }
+
+    if (m->shader != boundShader) {
+      boundShader = m->shader;
+      shader_bind(boundShader);
+      stats_add(STAT_STATE_CHANGES, 1);
+      glUniformMatrix4fv(boundShader->viewLoc, 1, GL_FALSE,
+                         (float *)list->view);
+      glUniformMatrix4fv(boundShader->projLoc, 1, GL_FALSE,
+                         (float *)list->projection);
+      glUniform3fv(boundShader->lightPosLoc, 1, list->lightPos);
+      shader_bind_uniform_block(boundShader, "Lights",
+                                RENDERER_LIGHTS_UBO_BINDING);
+    }
+
+    if (cmd->material != boundMaterial) {
+      boundMaterial = cmd->material;
+      material_bind(boundMaterial);
+    }
+
+    if (cmd->mesh->VAO != boundVAO) {
+      boundVAO = cmd->mesh->VAO;
+      glBindVertexArray(boundVAO);
+      stats_add(STAT_STATE_CHANGES, 1);
+    }
+
+    glUniformMatrix4fv(boundShader->modelLoc, 1, GL_FALSE,
+                       (float *)cmd->transform);
+
+    if (cmd->model)
+      model_draw_batch(cmd->model, cmd->batch);
+    else
+      mesh_draw_bound(cmd->mesh);
+
+    gldebug_pop_group();
+  }
+
+  glBindVertexArray(0);
+}
+
+void renderer_draw_skybox(const Skybox *sky) {
+  if (!executing)
+    return;
+
+  // drop the translation, the sky stays infinitely far away
+  mat4 skyView;
+  glm_mat4_copy(executing->view, skyView);
+  skyView[3][0] = skyView[3][1] = skyView[3][2] = 0.0f;
+
+  shader_bind(sky->shader);
+  glUniformMatrix4fv(sky->shader->viewLoc, 1, GL_FALSE, (float *)skyView);
+  glUniformMatrix4fv(sky->shader->projLoc, 1, GL_FALSE,
+                     (float *)executing->projection);
+
+  // the sky sits at depth 1.0: LEQUAL passes only where nothing was drawn
+  glDepthFunc(GL_LEQUAL);
+  glDepthMask(GL_FALSE);
+
+  texture_bind(&sky->cubemap, 0);
+  stats_add(STAT_STATE_CHANGES, 3); // program, cubemap, VAO
+  mesh_draw((Mesh *)&sky->cube);
+  glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+
+  glDepthMask(GL_TRUE);
+  glDepthFunc(GL_LESS);
+}
+
+void renderer_draw_overlay(const Shader *shader, const Texture *texture,
+                           unsigned int vao, int vertexCount, int width,
+                           int height) {
+  if (vertexCount <= 0)
+    return;
+
+  mat4 ortho;
+  glm_ortho(0.0f, (float)width, (float)height, 0.0f, -1.0f, 1.0f, ortho);
+
+  shader_bind(shader);
+  glUniformMatrix4fv(shader->projLoc, 1, GL_FALSE, (float *)ortho);
+
+  // the overlay stays readable in wireframe mode
+  GLint polygonMode[2];
+  glGetIntegerv(GL_POLYGON_MODE, polygonMode);
+  glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+  glDisable(GL_DEPTH_TEST);
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+  texture_bind(texture, 0);
+  glBindVertexArray(vao);
+  glDrawArrays(GL_TRIANGLES, 0, vertexCount);
+  glBindVertexArray(0);
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  glDisable(GL_BLEND);
+  glEnable(GL_DEPTH_TEST);
+  glPolygonMode(GL_FRONT_AND_BACK, polygonMode[0]);
 }
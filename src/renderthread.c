@@ -0,0 +1,174 @@
+#include "renderthread.h"
+#include "profiler.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <threads.h>
+
+/*
+
+   the renderthread module should only move frames from the main thread to
+   the thread that owns the GL context
+   it should NOT know what a frame draws, the RenderFrameFn does
+
+   the main thread builds packet N+1 (input, simulation, culling) while the
+   render thread submits packet N to GL and presents it. packets are used in
+   a ring: submitted - finished is how many are in flight, acquire waits for
+   the oldest to come back. the ring is the only shared state, under one
+   mutex, and a packet belongs to exactly one side at a time
+
+   OWNS: the render thread, the packets, the GL context while running
+
+   input: built packets
+   output: presented frames
+
+*/
+
+static FramePacket packets[RENDERTHREAD_MAX_PACKETS];
+static int packetCount = 0;
+
+static Window* window = NULL;
+static RenderFrameFn render = NULL;
+static void* renderUser = NULL;
+
+static thrd_t thread;
+static bool threaded = false;
+static mtx_t lock;
+static cnd_t queued;        // a packet was submitted or stop was asked
+static cnd_t finished;      // a packet was presented, or the thread took the context
+static int contextState = 0; // 1 once the render thread has the context, -1 if it failed to
+static uint64_t submitCount = 0;
+static uint64_t startCount = 0;
+static uint64_t finishCount = 0;
+static bool stopping = false;
+
+static void present(FramePacket* packet) {
+    render(packet, renderUser);
+    {
+        PROFILE_ZONE("present");
+        window_present(window);
+    }
+    time_frame_presented(&packet->times);
+}
+
+static int render_main(void* arg) {
+    (void)arg;
+    PROFILE_THREAD("render");
+
+    // renderthread_start waits for this before it returns
+    bool current = window_make_current(window, true);
+    mtx_lock(&lock);
+    contextState = current ? 1 : -1;
+    cnd_signal(&finished);
+    mtx_unlock(&lock);
+    if (!current) return 1;
+
+    for (;;) {
+        mtx_lock(&lock);
+        while (startCount == submitCount && !stopping) cnd_wait(&queued, &lock);
+        if (startCount == submitCount) {
+            mtx_unlock(&lock);
+            break;
+        }
+        FramePacket* packet = &packets[startCount % packetCount];
+        startCount++;
+        mtx_unlock(&lock);
+
+        present(packet);
+
+        mtx_lock(&lock);
+        finishCount++;
+        cnd_signal(&finished);
+        mtx_unlock(&lock);
+    }
+
+    window_make_current(window, false);
+    return 0;
+}
+
+bool renderthread_start(Window* win, int count, RenderFrameFn fn, void* user) {
+    if (count < 1 || count > RENDERTHREAD_MAX_PACKETS) {
+        fprintf(stderr, "Frames in flight must be 1 to %d, not %d\n", RENDERTHREAD_MAX_PACKETS, count);
+        return false;
+    }
+
+    memset(packets, 0, sizeof(packets));
+    packetCount = count;
+    window = win;
+    render = fn;
+    renderUser = user;
+    submitCount = startCount = finishCount = 0;
+    stopping = false;
+    threaded = count > 1;
+    if (!threaded) return true;
+
+    if (mtx_init(&lock, mtx_plain) != thrd_success || cnd_init(&queued) != thrd_success ||
+        cnd_init(&finished) != thrd_success) {
+        fprintf(stderr, "Failed to create the render thread's locks\n");
+        return false;
+    }
+
+    // a context is current on one thread at a time
+    window_make_current(window, false);
+    contextState = 0;
+    bool started = thrd_create(&thread, render_main, NULL) == thrd_success;
+    if (started) {
+        mtx_lock(&lock);
+        while (contextState == 0) cnd_wait(&finished, &lock);
+        mtx_unlock(&lock);
+        if (contextState < 0) thrd_join(thread, NULL);
+    }
+
+    if (!started || contextState < 0) {
+        fprintf(stderr, "Failed to start the render thread, rendering inline\n");
+        cnd_destroy(&queued);
+        cnd_destroy(&finished);
+        mtx_destroy(&lock);
+        window_make_current(window, true);
+        threaded = false;
+        packetCount = 1;
+    }
+    return true;
+}
+
+FramePacket* renderthread_acquire(void) {
+    if (!threaded) return &packets[0];
+
+    PROFILE_ZONE("wait for render thread");
+    mtx_lock(&lock);
+    while (submitCount - finishCount >= (uint64_t)packetCount) cnd_wait(&finished, &lock);
+    FramePacket* packet = &packets[submitCount % packetCount];
+    mtx_unlock(&lock);
+    return packet;
+}
+
+void renderthread_submit(FramePacket* packet) {
+    if (!threaded) {
+        present(packet);
+        return;
+    }
+
+    mtx_lock(&lock);
+    submitCount++;
+    cnd_signal(&queued);
+    mtx_unlock(&lock);
+}
+
+void renderthread_stop(void) {
+    if (threaded) {
+        mtx_lock(&lock);
+        stopping = true;
+        cnd_signal(&queued);
+        mtx_unlock(&lock);
+
+        thrd_join(thread, NULL);
+        cnd_destroy(&queued);
+        cnd_destroy(&finished);
+        mtx_destroy(&lock);
+        threaded = false;
+        window_make_current(window, true);
+    }
+
+    for (int i = 0; i < RENDERTHREAD_MAX_PACKETS; i++) renderer_list_free(&packets[i].list);
+    packetCount = 0;
+}
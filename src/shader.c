@@ -1,7 +1,19 @@
+#define _POSIX_C_SOURCE 200809L // mkdir
 #include <glad/glad.h>
+#include "gldebug.h"
+#include "loadstats.h"
 #include "shader.h"
+#include <stdarg.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <stdalign.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
 
 /*
 
@@ -11,11 +23,86 @@
 
    OWNS SHADER PROGRAMS AND UNIFORM STATE
 
-   input: shader source files (.vert/.frag), uniform values
+   sources are preprocessed before compiling: #include "file" is resolved
+   relative to the including file, and the feature bits of a variant become
+   #defines right after #version, so each variant only contains the code its
+   material uses
+
+   linked programs are kept in SHADER_CACHE_DIR as driver binaries, keyed by a
+   hash of the preprocessed sources and the driver strings. a stale or
+   rejected binary just falls back to compiling
+
+   variants can be requested up front: compile and link are issued at once and
+   only checked later (KHR_parallel_shader_compile lets the driver do this on
+   its own threads), so startup does not wait on the compiler between programs
+
+   with shader_watch_init, edits to the watched directory rebuild every cached
+   variant that read the file (directly or through #include). a rebuilt
+   program replaces the old id inside the same Shader, so pointers held by
+   materials stay valid; a failed rebuild keeps the old program
+
+   input: shader source files (.vert/.frag), feature bits, uniform values
    output: compiled shader programs ready for use by the renderer
 
 */
 
+#define SHADER_MAX_INCLUDE_DEPTH 8
+#define SHADER_MAX_DEPS 8
+#define SHADER_BINARY_MAGIC 0x42505252u // "RRPB"
+#define SHADER_BINARY_VERSION 1
+
+// header of a cached program binary, the driver's blob follows
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t format;
+    uint32_t length;
+    uint64_t key;
+} ProgramBinaryHeader;
+
+static ShaderCacheStats cacheStats;
+
+static const struct {
+    ShaderFeatures bit;
+    const char* define;
+} featureDefines[] = {
+    { SHADER_FEATURE_NORMAL_MAP, "NORMAL_MAP" },
+    { SHADER_FEATURE_PBR,        "PBR" },
+};
+
+// every file a program was built from, for hot reload
+typedef struct {
+    char paths[SHADER_MAX_DEPS][128];
+    int count;
+} ShaderDeps;
+
+// a program between build_begin and build_finish
+typedef struct {
+    char vertPath[128];
+    char fragPath[128];
+    unsigned int vs, fs; // stages, kept until the link is checked
+    uint64_t key;        // binary cache key
+    bool storeBinary;
+    bool pending;        // linked but not yet checked
+    ShaderDeps deps;
+} ProgramBuild;
+
+typedef struct {
+    Shader shader;
+    ProgramBuild build;
+} ShaderVariant;
+
+static ShaderVariant variants[SHADER_MAX_VARIANTS];
+static int variantCount = 0;
+
+static int watchFd = -1;
+static char watchDir[128];
+
+typedef struct {
+    char* data;
+    size_t len, cap;
+} Source;
+
 static char* read_file(const char* path) {
     FILE* f = fopen(path, "rb");
     if (!f) return NULL;
@@ -29,53 +116,552 @@ static char* read_file(const char* path) {
     return data;
 }
 
+static void source_append(Source* src, const char* text, size_t len) {
+    if (src->len + len + 1 > src->cap) {
+        size_t cap = src->cap ? src->cap : 4096;
+        while (src->len + len + 1 > cap) cap *= 2;
+        src->data = realloc(src->data, cap);
+        src->cap = cap;
+    }
+    memcpy(src->data + src->len, text, len);
+    src->len += len;
+    src->data[src->len] = 0;
+}
+
+static void source_appendf(Source* src, const char* fmt, ...) {
+    char line[320];
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(line, sizeof(line), fmt, args);
+    va_end(args);
+    if (n > (int)sizeof(line) - 1) n = (int)sizeof(line) - 1;
+    source_append(src, line, (size_t)n);
+}
+
+// #include "name" -> name, NULL for any other line
+static bool parse_include(const char* line, const char* end, char* name, size_t size) {
+    while (line < end && (*line == ' ' || *line == '\t')) line++;
+    if (end - line < 8 || strncmp(line, "#include", 8) != 0) return false;
+
+    const char* open = memchr(line, '"', end - line);
+    const char* close = open ? memchr(open + 1, '"', end - open - 1) : NULL;
+    if (!close) return false;
+
+    snprintf(name, size, "%.*s", (int)(close - open - 1), open + 1);
+    return true;
+}
+
+static void add_dependency(ShaderDeps* deps, const char* path) {
+    for (int i = 0; i < deps->count; i++)
+        if (strcmp(deps->paths[i], path) == 0) return;
+    if (deps->count == SHADER_MAX_DEPS) return;
+    snprintf(deps->paths[deps->count++], sizeof(deps->paths[0]), "%s", path);
+}
+
+static bool preprocess(Source* out, const char* path, ShaderFeatures features, ShaderDeps* deps, int depth) {
+    if (depth > SHADER_MAX_INCLUDE_DEPTH) {
+        fprintf(stderr, "Shader include depth exceeded at %s\n", path);
+        return false;
+    }
+
+    // recorded even if missing, creating the file later triggers a reload
+    add_dependency(deps, path);
+
+    char* text = read_file(path);
+    if (!text) {
+        fprintf(stderr, "Failed to read shader: %s\n", path);
+        return false;
+    }
+
+    const char* slash = strrchr(path, '/');
+    int dirLen = slash ? (int)(slash - path + 1) : 0;
+
+    bool ok = true;
+    int lineNo = 1;
+    for (const char* line = text; *line && ok; lineNo++) {
+        const char* end = strchr(line, '\n');
+        if (!end) end = line + strlen(line);
+        const char* next = *end ? end + 1 : end;
+
+        char name[128];
+        if (parse_include(line, end, name, sizeof(name))) {
+            char includePath[256];
+            snprintf(includePath, sizeof(includePath), "%.*s%s", dirLen, path, name);
+            source_appendf(out, "#line 1 // %s\n", includePath);
+            ok = preprocess(out, includePath, features, deps, depth + 1);
+            source_appendf(out, "#line %d // %s\n", lineNo + 1, path);
+        } else {
+            source_append(out, line, (size_t)(next - line));
+            if (*end == 0) source_append(out, "\n", 1);
+
+            // features go right after #version, which must stay the first line
+            if (depth == 0 && strncmp(line, "#version", 8) == 0) {
+                for (size_t f = 0; f < sizeof(featureDefines) / sizeof(featureDefines[0]); f++)
+                    if (features & featureDefines[f].bit)
+                        source_appendf(out, "#define %s 1\n", featureDefines[f].define);
+                source_appendf(out, "#line %d // %s\n", lineNo + 1, path);
+            }
+        }
+        line = next;
+    }
+
+    free(text);
+    return ok;
+}
+
+static char* load_source(const char* path, ShaderFeatures features, ShaderDeps* deps) {
+    Source src = { 0 };
+    if (!preprocess(&src, path, features, deps, 0)) {
+        free(src.data);
+        return NULL;
+    }
+    return src.data;
+}
+
+static uint64_t fnv1a(uint64_t hash, const void* data, size_t size) {
+    const unsigned char* bytes = data;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+static uint64_t fnv1a_str(uint64_t hash, const char* str) {
+    // include the terminator so ("ab","c") and ("a","bc") differ
+    return fnv1a(hash, str ? str : "", str ? strlen(str) + 1 : 1);
+}
+
+// everything that can change the linked program: sources (features are already
+// #defines in them) and the driver that compiled it
+static uint64_t program_key(const char* vs_src, const char* fs_src) {
+    uint64_t hash = 14695981039346656037ull;
+    hash = fnv1a_str(hash, vs_src);
+    hash = fnv1a_str(hash, fs_src);
+    hash = fnv1a_str(hash, (const char*)glGetString(GL_VENDOR));
+    hash = fnv1a_str(hash, (const char*)glGetString(GL_RENDERER));
+    hash = fnv1a_str(hash, (const char*)glGetString(GL_VERSION));
+    return hash;
+}
+
+static bool binary_cache_available(void) {
+    if (!GLAD_GL_ARB_get_program_binary) return false;
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    return formats > 0;
+}
+
+static void binary_path(uint64_t key, char* out, size_t size) {
+    snprintf(out, size, "%s/%016llx.bin", SHADER_CACHE_DIR, (unsigned long long)key);
+}
+
+// 0 if there is no usable binary, the driver may still reject one we return
+static unsigned int load_binary(uint64_t key) {
+    char path[256];
+    binary_path(key, path, sizeof(path));
+    FILE* f = fopen(path, "rb");
+    if (!f) return 0;
+
+    ProgramBinaryHeader header;
+    void* blob = NULL;
+    bool ok = fread(&header, sizeof(header), 1, f) == 1 &&
+              header.magic == SHADER_BINARY_MAGIC &&
+              header.version == SHADER_BINARY_VERSION &&
+              header.key == key && header.length > 0;
+    if (ok) {
+        blob = malloc(header.length);
+        ok = fread(blob, 1, header.length, f) == header.length;
+    }
+    fclose(f);
+
+    unsigned int program = 0;
+    if (ok) {
+        program = glCreateProgram();
+        glProgramBinary(program, header.format, blob, (GLsizei)header.length);
+
+        int success;
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        if (!success) {
+            // driver update or different GPU, recompile and overwrite
+            glDeleteProgram(program);
+            program = 0;
+            cacheStats.binaryRejects++;
+            remove(path);
+        }
+    }
+
+    free(blob);
+    return program;
+}
+
+static void store_binary(unsigned int program, uint64_t key) {
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) return;
+
+    ProgramBinaryHeader header = { SHADER_BINARY_MAGIC, SHADER_BINARY_VERSION, 0, 0, key };
+    void* blob = malloc((size_t)length);
+    GLsizei written = 0;
+    GLenum format = 0;
+    glGetProgramBinary(program, length, &written, &format, blob);
+    header.format = format;
+    header.length = (uint32_t)written;
+
+    mkdir(SHADER_CACHE_DIR, 0755);
+    char path[256];
+    binary_path(key, path, sizeof(path));
+    FILE* f = fopen(path, "wb");
+    if (f) {
+        fwrite(&header, sizeof(header), 1, f);
+        fwrite(blob, 1, (size_t)written, f);
+        fclose(f);
+    } else {
+        fprintf(stderr, "Cannot write shader binary %s\n", path);
+    }
+    free(blob);
+}
+
+// starts the compile, status is only read in build_finish so the driver can
+// work on it in the background
 static unsigned int compile(unsigned int type, const char* src) {
     unsigned int s = glCreateShader(type);
     glShaderSource(s, 1, &src, NULL);
     glCompileShader(s);
+    return s;
+}
 
+static void report_compile(unsigned int s, const char* path) {
     int success;
     char infoLog[512];
     glGetShaderiv(s, GL_COMPILE_STATUS, &success);
     if (!success) {
         glGetShaderInfoLog(s, 512, NULL, infoLog);
-        fprintf(stderr, "Shader compilation error: %s\n", infoLog);
+        fprintf(stderr, "Shader compilation error (%s): %s\n", path, infoLog);
     }
+}
 
-    return s;
+static void resolve_uniforms(Shader* shader) {
+    // uniforms the renderer sets on every shader, -1 when unused
+    shader->modelLoc = glGetUniformLocation(shader->id, "model");
+    shader->viewLoc = glGetUniformLocation(shader->id, "view");
+    shader->projLoc = glGetUniformLocation(shader->id, "projection");
+    shader->lightPosLoc = glGetUniformLocation(shader->id, "lightPos");
+}
+
+static void enable_parallel_compile(void) {
+    static bool enabled = false;
+    if (enabled || !GLAD_GL_KHR_parallel_shader_compile) return;
+    // let the driver choose how many compiler threads to use
+    glMaxShaderCompilerThreadsKHR(0xFFFFFFFFu);
+    enabled = true;
+}
+
+// Kick off a program: a cached binary is used directly, anything else is
+// compiled and linked without waiting for the result
+static bool build_begin(Shader* shader, ProgramBuild* build,
+                        const char* vs_path, const char* fs_path, ShaderFeatures features)
+{
+    memset(build, 0, sizeof(*build));
+    snprintf(build->vertPath, sizeof(build->vertPath), "%s", vs_path);
+    snprintf(build->fragPath, sizeof(build->fragPath), "%s", fs_path);
+
+    char* vs_src = load_source(vs_path, features, &build->deps);
+    char* fs_src = load_source(fs_path, features, &build->deps);
+    loadstats_bytes((vs_src ? strlen(vs_src) : 0) + (fs_src ? strlen(fs_src) : 0));
+    loadstats_stage(LOAD_READ);
+    if (!vs_src || !fs_src) {
+        free(vs_src);
+        free(fs_src);
+        return false;
+    }
+
+    bool useBinary = binary_cache_available();
+    build->key = useBinary ? program_key(vs_src, fs_src) : 0;
+    unsigned int program = useBinary ? load_binary(build->key) : 0;
+    cacheStats.programs++;
+
+    shader->id = program;
+    shader->features = features;
+    shader->prepared = false;
+
+    if (program) {
+        // already linked, usable right away
+        cacheStats.binaryHits++;
+        resolve_uniforms(shader);
+    } else {
+        enable_parallel_compile();
+        build->vs = compile(GL_VERTEX_SHADER, vs_src);
+        build->fs = compile(GL_FRAGMENT_SHADER, fs_src);
+
+        program = glCreateProgram();
+        if (useBinary)
+            glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        glAttachShader(program, build->vs);
+        glAttachShader(program, build->fs);
+        glLinkProgram(program);
+
+        build->storeBinary = useBinary;
+        build->pending = true;
+        shader->id = program;
+    }
+
+    if (gldebug_enabled()) {
+        char label[300];
+        snprintf(label, sizeof(label), "%s + %s features 0x%x", vs_path, fs_path, features);
+        gldebug_label(GL_PROGRAM, program, label);
+        gldebug_label(GL_SHADER, build->vs, vs_path);
+        gldebug_label(GL_SHADER, build->fs, fs_path);
+    }
+
+    free(vs_src);
+    free(fs_src);
+    return true;
+}
+
+// true once build_finish will not block
+static bool build_ready(const Shader* shader, const ProgramBuild* build) {
+    if (!build->pending) return true;
+    if (!GLAD_GL_KHR_parallel_shader_compile) return false;
+    int done = 0;
+    glGetProgramiv(shader->id, GL_COMPLETION_STATUS_KHR, &done);
+    return done;
+}
+
+// Wait for the link, report errors and resolve the uniforms the renderer uses
+static bool build_finish(Shader* shader, ProgramBuild* build) {
+    if (build->pending) {
+        build->pending = false;
+
+        int success;
+        char info[512];
+        glGetProgramiv(shader->id, GL_LINK_STATUS, &success);
+        if (!success) {
+            report_compile(build->vs, build->vertPath);
+            report_compile(build->fs, build->fragPath);
+            glGetProgramInfoLog(shader->id, 512, NULL, info);
+            fprintf(stderr, "Shader program link error (%s, %s, features 0x%x): %s\n",
+                    build->vertPath, build->fragPath, shader->features, info);
+        }
+
+        glDeleteShader(build->vs);
+        glDeleteShader(build->fs);
+        build->vs = build->fs = 0;
+
+        if (!success) {
+            glDeleteProgram(shader->id);
+            shader->id = 0;
+            return false;
+        }
+
+        cacheStats.compiled++;
+        if (build->storeBinary) store_binary(shader->id, build->key);
+        resolve_uniforms(shader);
+    }
+
+    return shader->id != 0;
 }
 
 bool shader_load(Shader* shader,
                  const char* vs_path,
                  const char* fs_path)
 {
-    char* vs_src = read_file(vs_path);
-    char* fs_src = read_file(fs_path);
-    if (!vs_src || !fs_src) return false;
+    return shader_load_variant(shader, vs_path, fs_path, 0);
+}
+
+bool shader_load_variant(Shader* shader,
+                         const char* vs_path,
+                         const char* fs_path,
+                         ShaderFeatures features)
+{
+    ProgramBuild build;
+    loadstats_begin("shader", fs_path);
+    bool ok = build_begin(shader, &build, vs_path, fs_path, features) && build_finish(shader, &build);
+    // compile and link, or the binary cache
+    loadstats_stage(LOAD_DECODE);
+    loadstats_end();
+    return ok;
+}
 
-    unsigned int vs = compile(GL_VERTEX_SHADER, vs_src);
-    unsigned int fs = compile(GL_FRAGMENT_SHADER, fs_src);
+static ShaderVariant* find_variant(const char* vs_path, const char* fs_path, ShaderFeatures features) {
+    for (int i = 0; i < variantCount; i++) {
+        ShaderVariant* v = &variants[i];
+        if (v->shader.features == features &&
+            strcmp(v->build.vertPath, vs_path) == 0 && strcmp(v->build.fragPath, fs_path) == 0)
+            return v;
+    }
+    return NULL;
+}
 
-	int success;
-	char info[512];
-	glGetProgramiv(shader->id, GL_LINK_STATUS, &success);
-	if (!success) {
-    	glGetProgramInfoLog(shader->id, 512, NULL, info);
-    	fprintf(stderr, "Shader program link error: %s\n", info);
-	}
+Shader* shader_request_variant(const char* vs_path,
+                               const char* fs_path,
+                               ShaderFeatures features)
+{
+    ShaderVariant* v = find_variant(vs_path, fs_path, features);
+    if (v) return &v->shader;
 
+    if (variantCount == SHADER_MAX_VARIANTS) {
+        fprintf(stderr, "Shader variant cache full, cannot add %s features 0x%x\n", fs_path, features);
+        return NULL;
+    }
 
-    free(vs_src);
-    free(fs_src);
+    v = &variants[variantCount];
+    // decode is only the dispatch here, the compile finishes in the background
+    loadstats_begin("shader variant", fs_path);
+    bool ok = build_begin(&v->shader, &v->build, vs_path, fs_path, features);
+    loadstats_stage(LOAD_DECODE);
+    loadstats_end();
+    if (!ok) return NULL;
+    variantCount++;
+    return &v->shader;
+}
+
+int shader_variant_index(const Shader* shader)
+{
+    for (int i = 0; i < variantCount; i++)
+        if (&variants[i].shader == shader) return i;
+    return -1;
+}
+
+Shader* shader_get_variant(const char* vs_path,
+                           const char* fs_path,
+                           ShaderFeatures features)
+{
+    ShaderVariant* v = find_variant(vs_path, fs_path, features);
+    if (!v) {
+        if (!shader_request_variant(vs_path, fs_path, features)) return NULL;
+        v = &variants[variantCount - 1];
+    }
+    if (v->build.pending) build_finish(&v->shader, &v->build);
+    return v->shader.id ? &v->shader : NULL;
+}
 
-    shader->id = glCreateProgram();
-    glAttachShader(shader->id, vs);
-    glAttachShader(shader->id, fs);
-    glLinkProgram(shader->id);
+int shader_poll_pending(void) {
+    int pending = 0;
+    for (int i = 0; i < variantCount; i++) {
+        ShaderVariant* v = &variants[i];
+        if (!v->build.pending) continue;
+        if (build_ready(&v->shader, &v->build))
+            build_finish(&v->shader, &v->build);
+        else
+            pending++;
+    }
+    return pending;
+}
 
-    glDeleteShader(vs);
-    glDeleteShader(fs);
+bool shader_finish_pending(void) {
+    bool ok = true;
+    for (int i = 0; i < variantCount; i++) {
+        ShaderVariant* v = &variants[i];
+        if (v->build.pending) build_finish(&v->shader, &v->build);
+        if (!v->shader.id) ok = false;
+    }
+    return ok;
+}
+
+bool shader_watch_init(const char* dir) {
+#ifdef __linux__
+    snprintf(watchDir, sizeof(watchDir), "%s", dir);
+    size_t len = strlen(watchDir);
+    if (len > 1 && watchDir[len - 1] == '/') watchDir[len - 1] = 0;
+
+    watchFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    // editors either rewrite the file or rename a temporary over it
+    if (watchFd < 0 || inotify_add_watch(watchFd, watchDir, IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        fprintf(stderr, "Cannot watch %s, shader hot reload is off\n", dir);
+        if (watchFd >= 0) close(watchFd);
+        watchFd = -1;
+        return false;
+    }
     return true;
+#else
+    (void)dir;
+    fprintf(stderr, "Shader hot reload needs inotify, it is off on this platform\n");
+    return false;
+#endif
+}
+
+static bool depends_on(const ShaderVariant* v, const char* path) {
+    for (int i = 0; i < v->build.deps.count; i++)
+        if (strcmp(v->build.deps.paths[i], path) == 0) return true;
+    return false;
+}
+
+// Build the variant again and swap the new program in only if it links
+static bool reload_variant(ShaderVariant* v) {
+    if (v->build.pending) build_finish(&v->shader, &v->build);
+
+    Shader fresh;
+    ProgramBuild build;
+    if (!build_begin(&fresh, &build, v->build.vertPath, v->build.fragPath, v->shader.features) ||
+        !build_finish(&fresh, &build)) {
+        fprintf(stderr, "Reload of %s + %s (features 0x%x) failed, keeping the previous program\n",
+                v->build.vertPath, v->build.fragPath, v->shader.features);
+        return false;
+    }
+
+    glDeleteProgram(v->shader.id);
+    v->shader = fresh;
+    v->build = build; // includes may have changed
+    printf("Reloaded %s + %s (features 0x%x)\n", v->build.vertPath, v->build.fragPath, v->shader.features);
+    return true;
+}
+
+int shader_watch_poll(void) {
+#ifdef __linux__
+    if (watchFd < 0) return 0;
+
+    char changed[16][256];
+    int changedCount = 0;
+
+    alignas(struct inotify_event) char events[4096];
+    ssize_t len;
+    while ((len = read(watchFd, events, sizeof(events))) > 0) {
+        for (char* p = events; p < events + len; ) {
+            const struct inotify_event* ev = (const struct inotify_event*)p;
+            p += sizeof(struct inotify_event) + ev->len;
+            if (ev->len == 0 || changedCount == 16) continue;
+
+            char path[256];
+            snprintf(path, sizeof(path), "%s/%s", watchDir, ev->name);
+            bool seen = false;
+            for (int i = 0; i < changedCount && !seen; i++)
+                seen = strcmp(changed[i], path) == 0;
+            if (!seen) snprintf(changed[changedCount++], sizeof(changed[0]), "%s", path);
+        }
+    }
+
+    int reloaded = 0;
+    for (int i = 0; i < variantCount; i++) {
+        bool affected = false;
+        for (int c = 0; c < changedCount && !affected; c++)
+            affected = depends_on(&variants[i], changed[c]);
+        if (affected && reload_variant(&variants[i])) reloaded++;
+    }
+    return reloaded;
+#else
+    return 0;
+#endif
+}
+
+ShaderCacheStats shader_cache_stats(void) {
+    return cacheStats;
+}
+
+void shader_cache_shutdown(void) {
+    for (int i = 0; i < variantCount; i++) {
+        // programs still linking are dropped along with their stages
+        if (variants[i].build.pending) {
+            glDeleteShader(variants[i].build.vs);
+            glDeleteShader(variants[i].build.fs);
+        }
+        shader_destroy(&variants[i].shader);
+    }
+    variantCount = 0;
+
+#ifdef __linux__
+    if (watchFd >= 0) close(watchFd);
+#endif
+    watchFd = -1;
 }
 
 void shader_bind(const Shader* shader) {
@@ -89,3 +675,9 @@ void shader_destroy(Shader* shader) {
 int shader_get_uniform(const Shader* shader, const char* name) {
     return glGetUniformLocation(shader->id, name);
 }
+
+void shader_bind_uniform_block(const Shader* shader, const char* name, unsigned int binding) {
+    unsigned int index = glGetUniformBlockIndex(shader->id, name);
+    if (index != GL_INVALID_INDEX)
+        glUniformBlockBinding(shader->id, index, binding);
+}
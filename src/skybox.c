@@ -0,0 +1,38 @@
+#include "skybox.h"
+#include <stdio.h>
+
+/*
+
+   the skybox module should only own the sky resources
+   it is drawn by the renderer after the opaque geometry
+
+   OWNS: cubemap texture, sky cube mesh (the shader belongs to the shader cache)
+
+   input: cubemap image path
+   output: resources for renderer_draw_skybox
+
+*/
+
+bool skybox_load(Skybox* sky, const char* path) {
+    if (!sky) return false;
+
+    // any conversion to cube faces happens here, never per frame
+    if (!texture_load_cubemap(&sky->cubemap, path))
+        return false;
+
+    sky->shader = shader_get_variant("shaders/vs_skybox.shdr", "shaders/fs_skybox.shdr", 0);
+    if (!sky->shader || !mesh_init_cube(&sky->cube)) {
+        fprintf(stderr, "Failed to create skybox for %s\n", path);
+        texture_destroy(&sky->cubemap);
+        return false;
+    }
+
+    // uSkybox keeps its default unit 0, which also survives a reload
+    return true;
+}
+
+void skybox_destroy(Skybox* sky) {
+    if (!sky) return;
+    texture_destroy(&sky->cubemap);
+    mesh_destroy(&sky->cube);
+}
@@ -0,0 +1,109 @@
+#include "stats.h"
+#include <stdlib.h>
+#include <string.h>
+
+/*
+
+   the stats module should only collect numbers the engine reports about itself
+   it should NOT measure anything, subsystems count their own work
+
+   counters are plain integer adds on a static array so they can sit in the
+   hottest loops. stats_end_frame snapshots them once per frame, which is the
+   only place anything is sorted or copied
+
+   OWNS: per-frame counters, memory gauges, frame time history
+
+   input: stats_add from the renderer, meshes, textures and buffers
+   output: last frame values and frame time percentiles for the HUD and logs
+
+*/
+
+int64_t statsCurrent[STAT_COUNT];
+static int64_t statsLast[STAT_COUNT];
+
+static const char* statNames[STAT_COUNT] = {
+    "draw calls",
+    "triangles",
+    "state changes",
+    "objects visible",
+    "objects culled",
+    "texture bytes",
+    "buffer bytes",
+};
+
+typedef struct {
+    float samples[STATS_HISTORY];
+    int head;
+    int count;
+    StatsTimes times;
+} Series;
+
+static Series series[STATS_SERIES_COUNT];
+
+static int compare_float(const void* a, const void* b) {
+    float fa = *(const float*)a, fb = *(const float*)b;
+    return fa < fb ? -1 : (fa > fb);
+}
+
+static void add_sample(Series* s, float ms) {
+    s->samples[s->head] = ms;
+    s->head = (s->head + 1) % STATS_HISTORY;
+    if (s->count < STATS_HISTORY) s->count++;
+
+    float sorted[STATS_HISTORY];
+    memcpy(sorted, s->samples, sizeof(float) * s->count);
+    qsort(sorted, s->count, sizeof(float), compare_float);
+
+    float sum = 0.0f;
+    for (int i = 0; i < s->count; i++) sum += sorted[i];
+
+    s->times.last = ms;
+    s->times.avg = sum / s->count;
+    s->times.p50 = sorted[(s->count * 50) / 100];
+    s->times.p95 = sorted[(s->count * 95) / 100];
+    s->times.p99 = sorted[(s->count * 99) / 100];
+    s->times.max = sorted[s->count - 1];
+}
+
+void stats_end_frame(float frameMs, float cpuMs) {
+    memcpy(statsLast, statsCurrent, sizeof(statsLast));
+    for (int i = 0; i < STAT_FIRST_GAUGE; i++) statsCurrent[i] = 0;
+
+    add_sample(&series[STATS_FRAME_MS], frameMs);
+    add_sample(&series[STATS_CPU_MS], cpuMs);
+}
+
+int64_t stats_get(StatId id) {
+    if (id < 0 || id >= STAT_COUNT) return 0;
+    return id >= STAT_FIRST_GAUGE ? statsCurrent[id] : statsLast[id];
+}
+
+const char* stats_name(StatId id) {
+    return id >= 0 && id < STAT_COUNT ? statNames[id] : "?";
+}
+
+StatsTimes stats_times(StatsSeries s) {
+    return series[s].times;
+}
+
+float stats_sample(StatsSeries s, int age) {
+    const Series* ser = &series[s];
+    if (age < 0 || age >= ser->count) return 0.0f;
+    return ser->samples[(ser->head - 1 - age + STATS_HISTORY) % STATS_HISTORY];
+}
+
+int stats_sample_count(StatsSeries s) {
+    return series[s].count;
+}
+
+void stats_dump(FILE* out) {
+    for (int i = 0; i < STAT_COUNT; i++)
+        fprintf(out, "  %-16s %lld\n", statNames[i], (long long)stats_get((StatId)i));
+
+    static const char* seriesNames[STATS_SERIES_COUNT] = { "frame ms", "cpu ms" };
+    for (int i = 0; i < STATS_SERIES_COUNT; i++) {
+        StatsTimes t = series[i].times;
+        fprintf(out, "  %-16s avg %7.3f  p50 %7.3f  p95 %7.3f  p99 %7.3f  max %7.3f\n",
+                seriesNames[i], t.avg, t.p50, t.p95, t.p99, t.max);
+    }
+}
@@ -0,0 +1,172 @@
+#include "gldebug.h"
+#include "stats.h"
+#include "streambuf.h"
+#include <stdio.h>
+#include <string.h>
+
+/*
+
+   the stream buffer module should only hand out write space for per-frame GPU data
+   it should NOT decide what the data is or how it is drawn
+
+   every write goes to the region of the current frame, so the GPU can keep
+   reading the regions of the previous frames. the CPU never waits on the GPU:
+   if the region we are about to reuse is still busy, the storage is orphaned
+   and the driver keeps the old one alive until the GPU is done with it
+
+   OWNS: one GL buffer object, its fences and its mapping
+
+   input: per-frame vertex/index/uniform data
+   output: buffer + offset to bind or point attributes at
+
+*/
+
+// bind through the copy target so we never touch VAO or uniform bindings
+#define STREAMBUF_BIND GL_COPY_WRITE_BUFFER
+
+#define PERSISTENT_FLAGS (GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT)
+
+static bool allocate_storage(StreamBuffer *sb) {
+    GLsizeiptr total = sb->regionSize * sb->regionCount;
+
+    glGenBuffers(1, &sb->id);
+    glBindBuffer(STREAMBUF_BIND, sb->id);
+
+    if (GLAD_GL_ARB_buffer_storage) {
+        glBufferStorage(STREAMBUF_BIND, total, NULL, PERSISTENT_FLAGS);
+        sb->persistent = glMapBufferRange(STREAMBUF_BIND, 0, total, PERSISTENT_FLAGS);
+        if (!sb->persistent) {
+            fprintf(stderr, "Stream buffer: persistent map failed\n");
+            glBindBuffer(STREAMBUF_BIND, 0);
+            glDeleteBuffers(1, &sb->id);
+            sb->id = 0;
+            return false;
+        }
+    } else {
+        glBufferData(STREAMBUF_BIND, total, NULL, GL_STREAM_DRAW);
+        sb->persistent = NULL;
+    }
+
+    glBindBuffer(STREAMBUF_BIND, 0);
+    gldebug_label(GL_BUFFER, sb->id, "stream buffer");
+    stats_add(STAT_BUFFER_BYTES, total);
+    return true;
+}
+
+static void release_fences(StreamBuffer *sb) {
+    for (int i = 0; i < STREAMBUF_MAX_REGIONS; i++) {
+        if (sb->fences[i]) {
+            glDeleteSync(sb->fences[i]);
+            sb->fences[i] = NULL;
+        }
+    }
+}
+
+// the GPU is still reading the region we need: take fresh storage instead of waiting
+static void orphan(StreamBuffer *sb) {
+    release_fences(sb);
+    sb->orphans++;
+
+    if (sb->persistent) {
+        // deleting a buffer the GPU still uses is deferred by the driver
+        glBindBuffer(STREAMBUF_BIND, sb->id);
+        glUnmapBuffer(STREAMBUF_BIND);
+        glBindBuffer(STREAMBUF_BIND, 0);
+        glDeleteBuffers(1, &sb->id);
+        stats_add(STAT_BUFFER_BYTES, -sb->regionSize * sb->regionCount);
+        sb->id = 0;
+        if (!allocate_storage(sb))
+            fprintf(stderr, "Stream buffer: failed to reallocate storage\n");
+    } else {
+        glBindBuffer(STREAMBUF_BIND, sb->id);
+        glBufferData(STREAMBUF_BIND, sb->regionSize * sb->regionCount, NULL, GL_STREAM_DRAW);
+        glBindBuffer(STREAMBUF_BIND, 0);
+    }
+}
+
+bool streambuf_init(StreamBuffer *sb, GLsizeiptr regionSize, int regionCount) {
+    if (!sb || regionSize <= 0 || regionCount < 2 || regionCount > STREAMBUF_MAX_REGIONS)
+        return false;
+
+    memset(sb, 0, sizeof(*sb));
+    sb->regionSize = regionSize;
+    sb->regionCount = regionCount;
+
+    return allocate_storage(sb);
+}
+
+void *streambuf_map(StreamBuffer *sb, GLsizeiptr size, GLsizeiptr align, GLintptr *offset) {
+    if (!sb || !sb->id || sb->mapped || size <= 0) return NULL;
+
+    if (align < 1) align = 1;
+    GLsizeiptr start = (sb->head + align - 1) & ~(align - 1);
+    if (start + size > sb->regionSize) return NULL;
+
+    GLintptr absolute = sb->region * sb->regionSize + start;
+    sb->head = start + size;
+    if (offset) *offset = absolute;
+
+    if (sb->persistent)
+        return sb->persistent + absolute;
+
+    // the fence already told us nobody reads this range, so skip the driver sync
+    glBindBuffer(STREAMBUF_BIND, sb->id);
+    void *ptr = glMapBufferRange(STREAMBUF_BIND, absolute, size,
+                                 GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT |
+                                 GL_MAP_INVALIDATE_RANGE_BIT);
+    glBindBuffer(STREAMBUF_BIND, 0);
+
+    sb->mapped = ptr != NULL;
+    return ptr;
+}
+
+void streambuf_unmap(StreamBuffer *sb) {
+    if (!sb || !sb->mapped) return;
+
+    glBindBuffer(STREAMBUF_BIND, sb->id);
+    glUnmapBuffer(STREAMBUF_BIND);
+    glBindBuffer(STREAMBUF_BIND, 0);
+    sb->mapped = false;
+}
+
+void streambuf_end_frame(StreamBuffer *sb) {
+    if (!sb || !sb->id) return;
+
+    streambuf_unmap(sb);
+
+    if (sb->fences[sb->region]) glDeleteSync(sb->fences[sb->region]);
+    sb->fences[sb->region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    sb->region = (sb->region + 1) % sb->regionCount;
+    sb->head = 0;
+
+    GLsync fence = sb->fences[sb->region];
+    if (!fence) return;
+
+    // zero timeout: only poll, never block
+    GLenum status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+    if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED) {
+        glDeleteSync(fence);
+        sb->fences[sb->region] = NULL;
+    } else {
+        orphan(sb);
+    }
+}
+
+void streambuf_destroy(StreamBuffer *sb) {
+    if (!sb) return;
+
+    release_fences(sb);
+    if (sb->id) {
+        if (sb->persistent || sb->mapped) {
+            glBindBuffer(STREAMBUF_BIND, sb->id);
+            glUnmapBuffer(STREAMBUF_BIND);
+            glBindBuffer(STREAMBUF_BIND, 0);
+        }
+        glDeleteBuffers(1, &sb->id);
+        stats_add(STAT_BUFFER_BYTES, -sb->regionSize * sb->regionCount);
+    }
+    sb->id = 0;
+    sb->persistent = NULL;
+    sb->mapped = false;
+}
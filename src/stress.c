@@ -0,0 +1,321 @@
+#include "stress.h"
+#include "jobs.h"
+#include "profiler.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+
+   the stress module should only generate scenes that load one subsystem at a
+   time, for scaling measurements with --bench
+   it should NOT draw anything itself, it queues draws like main's room does
+
+   every scene is a function of its spec: positions, colours and speeds come
+   from a seeded generator and animation only advances with stress_update, so
+   a benchmark of chairs:4000 draws the same frames on every machine.
+   stress_update runs at the simulation rate and keeps the step before,
+   stress_interpolate blends the two at the display rate. hierarchy chains
+   are independent of each other and update as jobs, one chain at a time
+
+   OWNS: generated transforms, textures, the cube mesh and point lights
+
+   input: a "kind:count[:seed]" spec, the chair model and plane mesh
+   output: queued draws, point lights
+
+*/
+
+#define STRESS_TEXTURE_SIZE 32
+#define STRESS_MAX_COUNT 1000000
+
+static const char* kindNames[] = { "chairs", "lights", "quads", "hierarchy" };
+
+// xorshift32, the same sequence everywhere rand() is not
+static float random01(uint32_t* state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return (float)(x >> 8) / (float)(1u << 24);
+}
+
+static float random_range(uint32_t* state, float lo, float hi) {
+    return lo + (hi - lo) * random01(state);
+}
+
+static bool parse_spec(StressScene* scene, const char* spec, uint32_t* seed) {
+    char kind[16];
+    unsigned int seedArg = 1;
+    int fields = sscanf(spec, "%15[^:]:%d:%u", kind, &scene->count, &seedArg);
+    if (fields < 2 || scene->count <= 0 || scene->count > STRESS_MAX_COUNT) {
+        fprintf(stderr, "Bad scene '%s', expected kind:count[:seed]\n", spec);
+        return false;
+    }
+
+    for (int i = 0; i < (int)(sizeof(kindNames) / sizeof(kindNames[0])); i++) {
+        if (strcmp(kind, kindNames[i]) == 0) {
+            scene->kind = (StressKind)i;
+            *seed = seedArg ? seedArg : 1; // xorshift sticks at 0
+            return true;
+        }
+    }
+    fprintf(stderr, "Unknown scene '%s', one of chairs, lights, quads, hierarchy\n", kind);
+    return false;
+}
+
+static bool build_chairs(StressScene* scene, uint32_t* rng) {
+    scene->transforms = malloc(sizeof(mat4) * scene->count);
+    if (!scene->transforms) return false;
+
+    // square grid around the origin, each chair turned a random way
+    int side = (int)ceilf(sqrtf((float)scene->count));
+    float spacing = 1.2f;
+    for (int i = 0; i < scene->count; i++) {
+        float x = ((i % side) - (side - 1) * 0.5f) * spacing;
+        float z = ((i / side) - (side - 1) * 0.5f) * spacing;
+        mat4* t = &scene->transforms[i];
+        glm_mat4_identity(*t);
+        glm_translate(*t, (vec3){ x, 0.0f, z });
+        glm_rotate_y(*t, random_range(rng, 0.0f, 2.0f * GLM_PIf), *t);
+        glm_scale(*t, (vec3){ 0.5f, 0.5f, 0.5f });
+    }
+    scene->transformCount = scene->count;
+    return true;
+}
+
+static bool build_lights(StressScene* scene, uint32_t* rng) {
+    int count = scene->count;
+    if (count > RENDERER_MAX_POINT_LIGHTS) {
+        fprintf(stderr, "The renderer takes %d point lights, not %d\n", RENDERER_MAX_POINT_LIGHTS, count);
+        count = RENDERER_MAX_POINT_LIGHTS;
+    }
+
+    scene->lights = calloc(count, sizeof(PointLight));
+    scene->lightOrbits = malloc(sizeof(float) * 4 * count);
+    scene->lightFrom = malloc(sizeof(vec3) * count);
+    scene->lightTo = malloc(sizeof(vec3) * count);
+    if (!scene->lights || !scene->lightOrbits || !scene->lightFrom || !scene->lightTo) return false;
+
+    for (int i = 0; i < count; i++) {
+        float* orbit = &scene->lightOrbits[i * 4];
+        orbit[0] = random_range(rng, 1.0f, 10.0f);                      // radius
+        orbit[1] = random_range(rng, 0.3f, 2.5f);                       // height
+        orbit[2] = random_range(rng, 0.2f, 1.0f) * (i % 2 ? -1.0f : 1.0f); // speed
+        orbit[3] = random_range(rng, 0.0f, 2.0f * GLM_PIf);             // phase
+
+        PointLight* light = &scene->lights[i];
+        light->positionRadius[3] = 4.0f;
+        light->color[0] = random_range(rng, 0.2f, 1.0f) * 3.0f;
+        light->color[1] = random_range(rng, 0.2f, 1.0f) * 3.0f;
+        light->color[2] = random_range(rng, 0.2f, 1.0f) * 3.0f;
+    }
+    scene->lightCount = count;
+    return true;
+}
+
+static bool build_quads(StressScene* scene, uint32_t* rng) {
+    int count = scene->count;
+    int available = MATERIAL_MAX - material_count();
+    if (count > available) {
+        fprintf(stderr, "Only %d materials left, %d quads instead of %d\n", available, available, count);
+        count = available;
+    }
+
+    scene->transforms = malloc(sizeof(mat4) * count);
+    scene->materials = malloc(sizeof(MaterialId) * count);
+    scene->textures = calloc(count, sizeof(Texture));
+    if (!scene->transforms || !scene->materials || !scene->textures) return false;
+
+    unsigned char pixels[STRESS_TEXTURE_SIZE * STRESS_TEXTURE_SIZE * 3];
+    for (int i = 0; i < count; i++) {
+        // a checker of two random colours, so no two quads share a texture
+        unsigned char colors[2][3];
+        for (int c = 0; c < 6; c++) colors[c / 3][c % 3] = (unsigned char)(random01(rng) * 255.0f);
+        for (int y = 0; y < STRESS_TEXTURE_SIZE; y++) {
+            for (int x = 0; x < STRESS_TEXTURE_SIZE; x++) {
+                const unsigned char* color = colors[((x / 8) + (y / 8)) % 2];
+                memcpy(&pixels[(y * STRESS_TEXTURE_SIZE + x) * 3], color, 3);
+            }
+        }
+        if (!texture_create(&scene->textures[i], STRESS_TEXTURE_SIZE, STRESS_TEXTURE_SIZE, 3, pixels))
+            return false;
+        scene->textureCount++;
+
+        char name[32];
+        snprintf(name, sizeof(name), "stress quad %d", i);
+        scene->materials[i] = material_create(name, 0);
+        material_get(scene->materials[i])->textures[MATERIAL_SLOT_ALBEDO] = &scene->textures[i];
+
+        // upright, facing a random way, the plane mesh lies on XZ
+        float width = random_range(rng, 0.5f, 2.0f), height = random_range(rng, 0.5f, 2.0f);
+        vec3 position = { random_range(rng, -12.0f, 12.0f), height * 0.5f, random_range(rng, -12.0f, 12.0f) };
+        mat4* t = &scene->transforms[i];
+        glm_mat4_identity(*t);
+        glm_translate(*t, position);
+        glm_rotate_y(*t, random_range(rng, 0.0f, 2.0f * GLM_PIf), *t);
+        glm_rotate(*t, glm_rad(90.0f), (vec3){ 1.0f, 0.0f, 0.0f });
+        glm_scale(*t, (vec3){ width, 1.0f, height });
+    }
+    scene->transformCount = count;
+    return true;
+}
+
+static bool build_hierarchy(StressScene* scene, uint32_t* rng) {
+    int total = STRESS_HIERARCHY_CHAINS * scene->count;
+    scene->nodes = calloc(total, sizeof(StressNode));
+    scene->transforms = malloc(sizeof(mat4) * total);
+    if (!scene->nodes || !scene->transforms) return false;
+    if (!mesh_init_cube(&scene->cube)) return false;
+    scene->hasCube = true;
+
+    // roots on a ring, every node a small step up a twisting helix from its parent
+    int n = 0;
+    for (int chain = 0; chain < STRESS_HIERARCHY_CHAINS; chain++) {
+        float angle = 2.0f * GLM_PIf * chain / STRESS_HIERARCHY_CHAINS;
+        for (int depth = 0; depth < scene->count; depth++, n++) {
+            StressNode* node = &scene->nodes[n];
+            node->parent = depth == 0 ? -1 : n - 1;
+            if (depth == 0)
+                glm_vec3_copy((vec3){ 6.0f * cosf(angle), 0.1f, 6.0f * sinf(angle) }, node->offset);
+            else
+                glm_vec3_copy((vec3){ 0.3f, 0.04f, 0.0f }, node->offset);
+            node->spin = random_range(rng, 0.1f, 0.5f) * (depth % 2 ? -1.0f : 1.0f);
+        }
+    }
+    scene->nodeCount = total;
+    scene->transformCount = total;
+    return true;
+}
+
+bool stress_create(StressScene* scene, const char* spec, const Model* chair, const Mesh* plane) {
+    memset(scene, 0, sizeof(*scene));
+    scene->chair = chair;
+    scene->plane = plane;
+
+    uint32_t rng;
+    if (!parse_spec(scene, spec, &rng)) return false;
+
+    bool ok = false;
+    switch (scene->kind) {
+    case STRESS_CHAIRS: ok = build_chairs(scene, &rng); break;
+    case STRESS_LIGHTS: ok = build_lights(scene, &rng); break;
+    case STRESS_QUADS: ok = build_quads(scene, &rng); break;
+    case STRESS_HIERARCHY: ok = build_hierarchy(scene, &rng); break;
+    }
+    if (!ok) {
+        fprintf(stderr, "Failed to build scene %s\n", spec);
+        stress_destroy(scene);
+        return false;
+    }
+
+    // twice, so the step before is the first step until the scene runs
+    stress_update(scene, 0.0f);
+    stress_update(scene, 0.0f);
+    stress_interpolate(scene, 1.0f);
+    printf("Stress scene %s: %d %s\n", spec, scene->count, kindNames[scene->kind]);
+    return true;
+}
+
+// chains [begin, end), parents first so every world matrix is a single
+// multiply away
+static void update_chains(int begin, int end, void* user) {
+    StressScene* scene = user;
+    for (int i = begin * scene->count; i < end * scene->count; i++) {
+        StressNode* node = &scene->nodes[i];
+        glm_mat4_copy(node->world, node->previous);
+        mat4 local;
+        glm_translate_make(local, node->offset);
+        glm_rotate_y(local, node->spin * scene->time, local);
+        if (node->parent < 0)
+            glm_mat4_copy(local, node->world);
+        else
+            glm_mat4_mul(scene->nodes[node->parent].world, local, node->world);
+    }
+}
+
+typedef struct {
+    StressScene* scene;
+    float alpha;
+} Blend;
+
+// a plain blend of the matrices, the rotation between two steps is too small
+// for the blend to visibly shrink anything
+static void interpolate_nodes(int begin, int end, void* user) {
+    const Blend* blend = user;
+    StressScene* scene = blend->scene;
+    for (int i = begin; i < end; i++) {
+        const StressNode* node = &scene->nodes[i];
+        const float* from = node->previous[0];
+        const float* to = node->world[0];
+        float* out = scene->transforms[i][0];
+        for (int k = 0; k < 16; k++) out[k] = from[k] + (to[k] - from[k]) * blend->alpha;
+        glm_scale(scene->transforms[i], (vec3){ 0.15f, 0.15f, 0.15f });
+    }
+}
+
+void stress_update(StressScene* scene, float deltaTime) {
+    PROFILE_ZONE("stress update");
+    scene->time += deltaTime;
+
+    if (scene->kind == STRESS_LIGHTS) {
+        for (int i = 0; i < scene->lightCount; i++) {
+            const float* orbit = &scene->lightOrbits[i * 4];
+            float angle = orbit[3] + orbit[2] * scene->time;
+            glm_vec3_copy(scene->lightTo[i], scene->lightFrom[i]);
+            glm_vec3_copy((vec3){ orbit[0] * cosf(angle), orbit[1], orbit[0] * sinf(angle) }, scene->lightTo[i]);
+        }
+    }
+
+    // short chains are not worth a job each
+    if (scene->kind == STRESS_HIERARCHY)
+        jobs_parallel_for(STRESS_HIERARCHY_CHAINS, 256 / scene->count + 1, update_chains, scene);
+}
+
+void stress_interpolate(StressScene* scene, float alpha) {
+    if (scene->kind == STRESS_LIGHTS) {
+        for (int i = 0; i < scene->lightCount; i++)
+            glm_vec3_lerp(scene->lightFrom[i], scene->lightTo[i], alpha, scene->lights[i].positionRadius);
+        renderer_set_point_lights(scene->lights, scene->lightCount);
+    }
+
+    if (scene->kind == STRESS_HIERARCHY) {
+        Blend blend = { scene, alpha };
+        jobs_parallel_for(scene->nodeCount, 512, interpolate_nodes, &blend);
+    }
+}
+
+void stress_draw(const StressScene* scene) {
+    switch (scene->kind) {
+    case STRESS_CHAIRS:
+        for (int i = 0; i < scene->transformCount; i++)
+            renderer_draw_model(scene->chair, scene->transforms[i]);
+        break;
+    case STRESS_QUADS:
+        for (int i = 0; i < scene->transformCount; i++)
+            renderer_draw_mesh(scene->plane, scene->materials[i], scene->transforms[i]);
+        break;
+    case STRESS_HIERARCHY:
+        for (int i = 0; i < scene->transformCount; i++)
+            renderer_draw_mesh(&scene->cube, MATERIAL_DEFAULT, scene->transforms[i]);
+        break;
+    case STRESS_LIGHTS:
+        break; // lights only, the room is what they shade
+    }
+}
+
+void stress_destroy(StressScene* scene) {
+    if (scene->lightCount > 0) renderer_set_point_lights(NULL, 0);
+    for (int i = 0; i < scene->textureCount; i++) texture_destroy(&scene->textures[i]);
+    if (scene->hasCube) mesh_destroy(&scene->cube);
+    free(scene->transforms);
+    free(scene->materials);
+    free(scene->textures);
+    free(scene->nodes);
+    free(scene->lights);
+    free(scene->lightOrbits);
+    free(scene->lightFrom);
+    free(scene->lightTo);
+    memset(scene, 0, sizeof(*scene));
+}
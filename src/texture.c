@@ -1,13 +1,24 @@
 #include <glad/glad.h>
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
+#include "gldebug.h"
+#include "jobs.h"
+#include "loadstats.h"
+#include "profiler.h"
+#include "stats.h"
 #include "texture.h"
+#include <cglm/cglm.h>
+#include <math.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 /*
 
    the texture module should only load, store, bind, and unbind textures
 
+   images that come in several files decode as one job each, and per-pixel
+   conversion splits by rows. GL calls stay on the calling thread
+
    OWNS: GPU texture object
 
    input: image file or pixel data
@@ -16,15 +27,19 @@
 */
 
 
-bool texture_load(Texture *texture, const char *path)
+// what the driver stores for the texture, a full mip chain adds a third
+static int64_t texture_bytes(const Texture *texture)
 {
-    stbi_set_flip_vertically_on_load(0); // Flip vertically: OpenGL origin is bottom-left
+    int64_t level = (int64_t)texture->width * texture->height * texture->channels;
+    return texture->target == GL_TEXTURE_CUBE_MAP ? level * 6 : level * 4 / 3;
+}
 
-    unsigned char *data = stbi_load(path, &texture->width, &texture->height, &texture->channels, 0);
-    if (!data) {
-        fprintf(stderr, "Failed to load texture: %s\n", path);
-        return false;
-    }
+bool texture_create(Texture *texture, int width, int height, int channels, const unsigned char *pixels)
+{
+    texture->target = GL_TEXTURE_2D;
+    texture->width = width;
+    texture->height = height;
+    texture->channels = channels;
 
     glGenTextures(1, &texture->id);
     glBindTexture(GL_TEXTURE_2D, texture->id);
@@ -38,22 +53,377 @@ bool texture_load(Texture *texture, const char *path)
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
 
     // Determine format
-    GLenum format = (texture->channels == 4) ? GL_RGBA : GL_RGB;
+    GLenum format = (channels == 4) ? GL_RGBA : (channels == 1) ? GL_RED : GL_RGB;
 
-    // Upload texture to GPU
-    glTexImage2D(GL_TEXTURE_2D, 0, format, texture->width, texture->height, 0, format, GL_UNSIGNED_BYTE, data);
+    // Upload texture to GPU, rows of 1 and 3 channel images are not 4-byte aligned
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, pixels);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    loadstats_stage(LOAD_UPLOAD);
     glGenerateMipmap(GL_TEXTURE_2D);
+    loadstats_stage(LOAD_MIPS);
+    stats_add(STAT_TEXTURE_BYTES, texture_bytes(texture));
 
-    stbi_image_free(data);
     glBindTexture(GL_TEXTURE_2D, 0);
 
     return true;
 }
 
+// whole file in memory, so reading and decoding can be timed apart
+static unsigned char *read_file(const char *path, int *size)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f)
+        return NULL;
+    fseek(f, 0, SEEK_END);
+    long length = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    unsigned char *data = length > 0 ? malloc(length) : NULL;
+    if (data && fread(data, 1, length, f) != (size_t)length) {
+        free(data);
+        data = NULL;
+    }
+    fclose(f);
+    *size = (int)length;
+    return data;
+}
+
+bool texture_load(Texture *texture, const char *path)
+{
+    PROFILE_ZONE("texture_load");
+    loadstats_begin("texture", path);
+
+    int fileSize = 0;
+    unsigned char *file = read_file(path, &fileSize);
+    loadstats_bytes(fileSize);
+    loadstats_stage(LOAD_READ);
+
+    stbi_set_flip_vertically_on_load(0); // Flip vertically: OpenGL origin is bottom-left
+
+    // grey images expand to RGB so .rgb samples stay correct
+    int width, height, channels;
+    int wanted = 3;
+    if (file && stbi_info_from_memory(file, fileSize, &width, &height, &channels) &&
+        (channels == 2 || channels == 4))
+        wanted = 4;
+
+    unsigned char *data = file ? stbi_load_from_memory(file, fileSize, &width, &height, &channels, wanted) : NULL;
+    free(file);
+    loadstats_stage(LOAD_DECODE);
+    if (!data) {
+        fprintf(stderr, "Failed to load texture: %s\n", path);
+        loadstats_end();
+        return false;
+    }
+
+    bool ok = texture_create(texture, width, height, wanted, data);
+    stbi_image_free(data);
+    gldebug_label(GL_TEXTURE, texture->id, path);
+
+    loadstats_end();
+    return ok;
+}
+
+typedef struct {
+    const char *path;
+    int desired;        // channels, 0 for the file's own
+    unsigned char *pixels;
+    int width, height, channels;
+} DecodeJob;
+
+static void decode_file(void *user)
+{
+    DecodeJob *job = user;
+    job->pixels = stbi_load(job->path, &job->width, &job->height, &job->channels, job->desired);
+}
+
+typedef struct {
+    unsigned char *maps[3];
+    int mapW[3], mapH[3];
+    int width, height;
+    unsigned char *packed;
+} PackJob;
+
+static void pack_rows(int begin, int end, void *user)
+{
+    const PackJob *job = user;
+    const unsigned char defaults[3] = { 255, 255, 0 };
+    int width = job->width, height = job->height;
+
+    for (int y = begin; y < end; y++) {
+        for (int x = 0; x < width; x++) {
+            unsigned char *dst = job->packed + ((size_t)y * width + x) * 3;
+            for (int c = 0; c < 3; c++) {
+                if (!job->maps[c]) {
+                    dst[c] = defaults[c];
+                    continue;
+                }
+                // maps of another size are resampled nearest, exports rarely mix sizes
+                int sx = x * job->mapW[c] / width;
+                int sy = y * job->mapH[c] / height;
+                dst[c] = job->maps[c][(size_t)sy * job->mapW[c] + sx];
+            }
+        }
+    }
+}
+
+bool texture_pack_orm(Texture *texture, const char *aoPath, const char *roughnessPath, const char *metalnessPath)
+{
+    PROFILE_ZONE("texture_pack_orm");
+    loadstats_begin("orm", aoPath ? aoPath : roughnessPath ? roughnessPath : metalnessPath ? metalnessPath : "-");
+
+    const char *paths[3] = { aoPath, roughnessPath, metalnessPath };
+
+    // decode as one channel, one job a map. stb reads the files itself,
+    // decode includes the reads
+    DecodeJob decodes[3] = { { 0 } };
+    JobCounter decoded = { 0 };
+    for (int c = 0; c < 3; c++) {
+        if (!paths[c]) continue;
+        decodes[c].path = paths[c];
+        decodes[c].desired = 1;
+        jobs_run(decode_file, &decodes[c], &decoded);
+    }
+    jobs_wait(&decoded);
+
+    // the first map found sets the packed size
+    PackJob pack = { 0 };
+    for (int c = 0; c < 3; c++) {
+        if (!paths[c]) continue;
+        if (!decodes[c].pixels) {
+            fprintf(stderr, "Failed to load texture: %s\n", paths[c]);
+            continue;
+        }
+        pack.maps[c] = decodes[c].pixels;
+        pack.mapW[c] = decodes[c].width;
+        pack.mapH[c] = decodes[c].height;
+        if (pack.width == 0) {
+            pack.width = decodes[c].width;
+            pack.height = decodes[c].height;
+        }
+    }
+
+    loadstats_stage(LOAD_DECODE);
+    if (pack.width == 0) {
+        loadstats_end();
+        return false;
+    }
+
+    int width = pack.width, height = pack.height;
+    unsigned char *packed = malloc((size_t)width * height * 3);
+    pack.packed = packed;
+    jobs_parallel_for(height, 16, pack_rows, &pack);
+
+    loadstats_stage(LOAD_CONVERT);
+
+    bool ok = texture_create(texture, width, height, 3, packed);
+    if (gldebug_enabled()) {
+        char label[512];
+        snprintf(label, sizeof(label), "orm %s + %s + %s", aoPath ? aoPath : "-",
+                 roughnessPath ? roughnessPath : "-", metalnessPath ? metalnessPath : "-");
+        gldebug_label(GL_TEXTURE, texture->id, label);
+    }
+
+    free(packed);
+    for (int c = 0; c < 3; c++)
+        stbi_image_free(pack.maps[c]);
+
+    loadstats_end();
+    return ok;
+}
+
+// Cubemap face directions for texel (s, t) in [-1, 1], in GL face order +X -X +Y -Y +Z -Z
+static void cube_face_direction(int face, float s, float t, float dir[3])
+{
+    switch (face) {
+    case 0: dir[0] =  1.0f; dir[1] = -t;    dir[2] = -s;    break;
+    case 1: dir[0] = -1.0f; dir[1] = -t;    dir[2] =  s;    break;
+    case 2: dir[0] =  s;    dir[1] =  1.0f; dir[2] =  t;    break;
+    case 3: dir[0] =  s;    dir[1] = -1.0f; dir[2] = -t;    break;
+    case 4: dir[0] =  s;    dir[1] = -t;    dir[2] =  1.0f; break;
+    default: dir[0] = -s;   dir[1] = -t;    dir[2] = -1.0f; break;
+    }
+}
+
+// Bilinear fetch from an equirectangular image, u wraps and v clamps
+static void sample_equirect(const unsigned char *img, int w, int h, int channels,
+                            float u, float v, unsigned char *out)
+{
+    float x = u * w - 0.5f;
+    float y = v * h - 0.5f;
+    int x0 = (int)floorf(x), y0 = (int)floorf(y);
+    float fx = x - x0, fy = y - y0;
+
+    int xs[2] = { ((x0 % w) + w) % w, (((x0 + 1) % w) + w) % w };
+    int ys[2] = { y0 < 0 ? 0 : (y0 >= h ? h - 1 : y0),
+                  y0 + 1 < 0 ? 0 : (y0 + 1 >= h ? h - 1 : y0 + 1) };
+
+    for (int c = 0; c < channels; c++) {
+        float top = img[(ys[0] * w + xs[0]) * channels + c] * (1.0f - fx) +
+                    img[(ys[0] * w + xs[1]) * channels + c] * fx;
+        float bottom = img[(ys[1] * w + xs[0]) * channels + c] * (1.0f - fx) +
+                       img[(ys[1] * w + xs[1]) * channels + c] * fx;
+        out[c] = (unsigned char)(top * (1.0f - fy) + bottom * fy + 0.5f);
+    }
+}
+
+static void upload_cubemap(Texture *texture, unsigned char *faces[6], int size, int channels)
+{
+    GLenum format = (channels == 4) ? GL_RGBA : GL_RGB;
+
+    texture->target = GL_TEXTURE_CUBE_MAP;
+    texture->width = texture->height = size;
+    texture->channels = channels;
+
+    glGenTextures(1, &texture->id);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, texture->id);
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (int f = 0; f < 6; f++)
+        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + f, 0, format, size, size, 0, format, GL_UNSIGNED_BYTE, faces[f]);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    stats_add(STAT_TEXTURE_BYTES, texture_bytes(texture));
+
+    glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+}
+
+typedef struct {
+    const unsigned char *img;
+    int w, h, channels;
+    int size;
+    unsigned char **faces;
+} ResampleJob;
+
+// rows [begin, end) of the six faces stacked, face f has rows f*size onward
+static void resample_rows(int begin, int end, void *user)
+{
+    const ResampleJob *job = user;
+    int size = job->size, channels = job->channels;
+
+    for (int row = begin; row < end; row++) {
+        int f = row / size, j = row % size;
+        for (int i = 0; i < size; i++) {
+            float dir[3];
+            cube_face_direction(f, 2.0f * (i + 0.5f) / size - 1.0f,
+                                   2.0f * (j + 0.5f) / size - 1.0f, dir);
+            float len = sqrtf(dir[0] * dir[0] + dir[1] * dir[1] + dir[2] * dir[2]);
+            float u = 0.5f + atan2f(dir[2], dir[0]) / (2.0f * GLM_PIf);
+            float v = 0.5f - asinf(dir[1] / len) / GLM_PIf;
+            sample_equirect(job->img, job->w, job->h, channels, u, v,
+                            job->faces[f] + ((size_t)j * size + i) * channels);
+        }
+    }
+}
+
+static bool load_cubemap_equirect(Texture *texture, const char *path)
+{
+    int w, h, channels;
+    unsigned char *img = stbi_load(path, &w, &h, &channels, 0);
+    if (!img) return false;
+
+    // one face spans 90 degrees, a quarter of the 360 degree width
+    int size = w / 4;
+    if (size < 1) size = 1;
+
+    unsigned char *faces[6];
+    for (int f = 0; f < 6; f++)
+        faces[f] = malloc((size_t)size * size * channels);
+
+    ResampleJob job = { img, w, h, channels, size, faces };
+    jobs_parallel_for(6 * size, 8, resample_rows, &job);
+
+    upload_cubemap(texture, faces, size, channels);
+
+    for (int f = 0; f < 6; f++) free(faces[f]);
+    stbi_image_free(img);
+    return true;
+}
+
+typedef struct {
+    const char *dir;
+    int face;
+    int desired;        // channels, 0 for the file's own
+    char path[512];     // the file found
+    unsigned char *pixels;
+    int width, height, channels;
+} FaceJob;
+
+static void decode_face(void *user)
+{
+    static const char *names[6] = { "px", "nx", "py", "ny", "pz", "nz" };
+    static const char *exts[2] = { "png", "jpg" };
+    FaceJob *job = user;
+
+    for (int e = 0; e < 2 && !job->pixels; e++) {
+        snprintf(job->path, sizeof(job->path), "%s/%s.%s", job->dir, names[job->face], exts[e]);
+        job->pixels = stbi_load(job->path, &job->width, &job->height, &job->channels, job->desired);
+    }
+}
+
+static bool load_cubemap_faces(Texture *texture, const char *dir)
+{
+    FaceJob faces[6] = { { 0 } };
+    for (int f = 0; f < 6; f++) {
+        faces[f].dir = dir;
+        faces[f].face = f;
+    }
+
+    // the first face sets the size and channels, the other five decode as jobs
+    decode_face(&faces[0]);
+    bool ok = faces[0].pixels != NULL;
+    int size = faces[0].width, channels = faces[0].channels;
+    if (ok) {
+        JobCounter decoded = { 0 };
+        for (int f = 1; f < 6; f++) {
+            faces[f].desired = channels;
+            jobs_run(decode_face, &faces[f], &decoded);
+        }
+        jobs_wait(&decoded);
+    }
+
+    unsigned char *pixels[6];
+    for (int f = 0; f < 6 && ok; f++) {
+        pixels[f] = faces[f].pixels;
+        if (!pixels[f]) {
+            ok = false;
+        } else if (faces[f].width != faces[f].height || faces[f].width != size) {
+            fprintf(stderr, "Cubemap face %s is not %dx%d\n", faces[f].path, size, size);
+            ok = false;
+        }
+    }
+
+    if (ok) upload_cubemap(texture, pixels, size, channels);
+
+    for (int f = 0; f < 6; f++)
+        if (faces[f].pixels) stbi_image_free(faces[f].pixels);
+    return ok;
+}
+
+bool texture_load_cubemap(Texture *texture, const char *path)
+{
+    int w, h, c;
+    bool loaded = stbi_info(path, &w, &h, &c)
+        ? load_cubemap_equirect(texture, path)
+        : load_cubemap_faces(texture, path);
+
+    if (!loaded) {
+        fprintf(stderr, "Failed to load cubemap: %s\n", path);
+        return false;
+    }
+    gldebug_label(GL_TEXTURE, texture->id, path);
+    return true;
+}
+
 void texture_bind(const Texture *texture, unsigned int unit)
 {
     glActiveTexture(GL_TEXTURE0 + unit); // Activate texture unit
-    glBindTexture(GL_TEXTURE_2D, texture->id);
+    glBindTexture(texture->target ? texture->target : GL_TEXTURE_2D, texture->id);
 }
 
 void texture_unbind(void)
@@ -63,6 +433,7 @@ void texture_unbind(void)
 
 void texture_destroy(Texture *texture)
 {
+    if (texture->id) stats_add(STAT_TEXTURE_BYTES, -texture_bytes(texture));
     glDeleteTextures(1, &texture->id);
     texture->id = 0;
 }
\ No newline at end of file
@@ -0,0 +1,116 @@
+#define _POSIX_C_SOURCE 200809L // clock_gettime, clock_nanosleep
+#include "timing.h"
+#include <errno.h>
+#include <time.h>
+
+/*
+
+   the timing module should only read the clock, mark where frames spend their
+   time and hold the frame rate to a limit
+   it should NOT decide what a frame does, main calls the marks in order
+
+   every time is an integer of nanoseconds, so deltas are as exact after a
+   week of uptime as after a second. floats appear only for the differences
+
+   the limiter sleeps until a margin before the deadline and spins the rest:
+   sleeping alone wakes up late by the scheduler's whim, spinning alone burns
+   a core. the margin follows how late sleeps have been waking up
+
+   OWNS: the clock origin, frame timestamps, the limiter deadline
+
+   input: frame marks, a target rate
+   output: delta times, timestamps, waits
+
+*/
+
+#define NS_PER_SECOND 1000000000ull
+#define SPIN_MARGIN_MIN 200000ull   // ns
+#define SPIN_MARGIN_MAX 4000000ull  // ns
+
+// the monotonic clock works without GLFW, so headless runs keep their timing
+static uint64_t start = 0;
+
+static FrameTimestamps current;     // the frame being built
+static FrameTimestamps last;        // the frame last presented
+
+static uint64_t framePeriod = 0;    // ns, 0 without a limit
+static uint64_t deadline = 0;       // when the next frame may start
+static uint64_t spinMargin = 1000000ull;
+
+static uint64_t clock_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * NS_PER_SECOND + (uint64_t)ts.tv_nsec;
+}
+
+uint64_t time_now_ns(void) {
+    uint64_t now = clock_ns();
+    if (start == 0) start = now - 1; // 0 stays free for "not marked"
+    return now - start;
+}
+
+double time_now(void) {
+    return (double)time_now_ns() * 1e-9;
+}
+
+float time_update(void) {
+    uint64_t now = time_now_ns();
+    uint64_t previous = current.start;
+    current.start = now;
+    current.cpuDone = current.present = 0;
+    return previous ? (float)((double)(now - previous) * 1e-9) : 0.0f;
+}
+
+float time_frame_cpu_done(void) {
+    current.cpuDone = time_now_ns();
+    return (float)((double)(current.cpuDone - current.start) * 1e-6);
+}
+
+FrameTimestamps time_frame_marks(void) {
+    return current;
+}
+
+// the frame arrives with its own start and cpuDone, the main thread may be
+// marking the next one already
+void time_frame_presented(FrameTimestamps* frame) {
+    frame->present = time_now_ns();
+    last = *frame;
+}
+
+FrameTimestamps time_last_frame(void) {
+    return last;
+}
+
+void time_set_frame_limit(double fps) {
+    framePeriod = fps > 0.0 ? (uint64_t)((double)NS_PER_SECOND / fps) : 0;
+    deadline = 0;
+}
+
+void time_limit_frame(void) {
+    if (framePeriod == 0) return;
+
+    uint64_t now = time_now_ns();
+    // deadlines follow each other, so a late frame does not push back the
+    // rest. after a real stall start over instead of rushing to catch up
+    deadline = deadline ? deadline + framePeriod : now + framePeriod;
+    if (now > deadline + framePeriod) deadline = now;
+    if (now >= deadline) return;
+
+    if (deadline - now > spinMargin) {
+        uint64_t wake = deadline - spinMargin;
+        uint64_t target = start + wake;
+        struct timespec ts = { (time_t)(target / NS_PER_SECOND), (long)(target % NS_PER_SECOND) };
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {
+        }
+
+        // late wake-ups widen the margin at once, it narrows again slowly
+        now = time_now_ns();
+        uint64_t late = now > wake ? now - wake : 0;
+        spinMargin = late * 3 / 2 > spinMargin ? late * 3 / 2 : spinMargin - spinMargin / 16;
+        if (spinMargin < SPIN_MARGIN_MIN) spinMargin = SPIN_MARGIN_MIN;
+        if (spinMargin > SPIN_MARGIN_MAX) spinMargin = SPIN_MARGIN_MAX;
+    }
+
+    while (time_now_ns() < deadline) {
+    }
+}
@@ -1,20 +1,170 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <glad/glad.h>
 #include "window.h"
+#ifdef __linux__
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+static bool debugContext = false;
+static bool headlessContext = false;
 
 static void glfw_error_callback(int error, const char *description)
 {
     fprintf(stderr, "GLFW Error (%d): %s\n", error, description);
 }
 
+void window_hint_debug(bool enable)
+{
+    debugContext = enable;
+}
+
+void window_hint_headless(bool enable)
+{
+    headlessContext = enable;
+}
+
+// the default framebuffer of a headless context is an FBO of the window size
+static bool create_offscreen_target(Window *window)
+{
+    glGenRenderbuffers(1, &window->colorBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, window->colorBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, window->width, window->height);
+
+    glGenRenderbuffers(1, &window->depthBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, window->depthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, window->width, window->height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &window->framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, window->framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, window->colorBuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, window->depthBuffer);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        fprintf(stderr, "Offscreen framebuffer %dx%d is incomplete\n", window->width, window->height);
+        return false;
+    }
+    return true;
+}
+
+#ifdef __linux__
+static bool has_extension(const char *list, const char *name)
+{
+    size_t length = strlen(name);
+    for (const char *p = list; p && (p = strstr(p, name)); p += length)
+        if ((p == list || p[-1] == ' ') && (p[length] == ' ' || p[length] == '\0'))
+            return true;
+    return false;
+}
+
+// Mesa's surfaceless platform needs no display server at all, otherwise the
+// default display with a 1x1 pbuffer just to make the context current
+static bool create_headless(Window *window)
+{
+    EGLDisplay display = EGL_NO_DISPLAY;
+    const char *clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (getPlatformDisplay && has_extension(clientExtensions, "EGL_MESA_platform_surfaceless"))
+        display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    if (display == EGL_NO_DISPLAY)
+        display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+    EGLint major, minor;
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor)) {
+        fprintf(stderr, "Failed to initialize EGL\n");
+        return false;
+    }
+    window->eglDisplay = display;
+
+    if (!eglBindAPI(EGL_OPENGL_API)) {
+        fprintf(stderr, "EGL has no desktop OpenGL\n");
+        return false;
+    }
+
+    const char *extensions = eglQueryString(display, EGL_EXTENSIONS);
+    const EGLint configAttribs[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8,
+        EGL_NONE
+    };
+    EGLConfig config = NULL;
+    EGLint configCount = 0;
+    if (!eglChooseConfig(display, configAttribs, &config, 1, &configCount) || configCount == 0) {
+        if (!has_extension(extensions, "EGL_KHR_no_config_context")) {
+            fprintf(stderr, "No EGL config for offscreen OpenGL\n");
+            return false;
+        }
+        config = EGL_NO_CONFIG_KHR;
+    }
+
+    // same 3.3 core profile as the GLFW window
+    const EGLint contextAttribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION_KHR, 3,
+        EGL_CONTEXT_MINOR_VERSION_KHR, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK_KHR, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT_KHR,
+        EGL_CONTEXT_FLAGS_KHR, debugContext ? EGL_CONTEXT_OPENGL_DEBUG_BIT_KHR : 0,
+        EGL_NONE
+    };
+    EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttribs);
+    if (context == EGL_NO_CONTEXT) {
+        fprintf(stderr, "Failed to create an OpenGL 3.3 core EGL context (0x%x)\n", eglGetError());
+        return false;
+    }
+    window->eglContext = context;
+
+    EGLSurface surface = EGL_NO_SURFACE;
+    if (!has_extension(extensions, "EGL_KHR_surfaceless_context") && config != EGL_NO_CONFIG_KHR) {
+        const EGLint pbufferAttribs[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+        surface = eglCreatePbufferSurface(display, config, pbufferAttribs);
+        window->eglSurface = surface;
+    }
+
+    if (!eglMakeCurrent(display, surface, surface, context)) {
+        fprintf(stderr, "Failed to make the EGL context current (0x%x)\n", eglGetError());
+        return false;
+    }
+
+    if (!gladLoadGLLoader((GLADloadproc)eglGetProcAddress)) {
+        fprintf(stderr, "Failed to initialize GLAD\n");
+        return false;
+    }
+
+    printf("Headless %dx%d on %s\n", window->width, window->height, (const char *)glGetString(GL_RENDERER));
+    return create_offscreen_target(window);
+}
+#else
+static bool create_headless(Window *window)
+{
+    (void)window;
+    fprintf(stderr, "Headless rendering needs EGL, only built on Linux\n");
+    return false;
+}
+#endif
+
 bool window_create(Window *window, int width, int height, const char *title)
 {
     if (!window) return false;
 
+    memset(window, 0, sizeof(*window));
     window->width = width;
     window->height = height;
     window->title = title;
 
+    if (headlessContext) {
+        window->headless = true;
+        if (create_headless(window)) {
+            glViewport(0, 0, width, height);
+            return true;
+        }
+        window_destroy(window);
+        return false;
+    }
+
     glfwSetErrorCallback(glfw_error_callback);
 
     if (!glfwInit()) {
@@ -27,6 +177,9 @@ bool window_create(Window *window, int width, int height, const char *title)
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
+    // debug contexts validate more and can be slower, only on request
+    glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, debugContext ? GLFW_TRUE : GLFW_FALSE);
+
     // i dont think this will ever be run on a mac but ill add it anyway
 #ifdef __APPLE__
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
@@ -57,25 +210,134 @@ bool window_create(Window *window, int width, int height, const char *title)
     return true;
 }
 
-void window_update(Window *window)
+void window_set_vsync(Window *window, WindowVsync mode)
 {
+    // a headless context never presents, so it never waits
+    if (!window || !window->handle) return;
+
+    if (mode == WINDOW_VSYNC_ADAPTIVE) {
+        // a negative interval is how GLX and WGL spell adaptive
+        if (glfwExtensionSupported("GLX_EXT_swap_control_tear") ||
+            glfwExtensionSupported("WGL_EXT_swap_control_tear")) {
+            glfwSwapInterval(-1);
+            return;
+        }
+        fprintf(stderr, "No adaptive vsync (EXT_swap_control_tear), using vsync\n");
+        mode = WINDOW_VSYNC_ON;
+    }
+    glfwSwapInterval(mode == WINDOW_VSYNC_ON ? 1 : 0);
+}
+
+void window_present(Window *window)
+{
+    // nothing to present, just hand the frame to the GPU like a swap would
+    if (window && window->headless) {
+        glFlush();
+        return;
+    }
+
     if (!window || !window->handle) return;
 
     glfwSwapBuffers(window->handle);
+}
+
+void window_poll_events(Window *window)
+{
+    if (!window || !window->handle) return;
+
     glfwPollEvents();
 }
 
+void window_update(Window *window)
+{
+    window_present(window);
+    window_poll_events(window);
+}
+
+bool window_make_current(Window *window, bool current)
+{
+    if (!window) return false;
+
+    if (window->headless) {
+#ifdef __linux__
+        EGLSurface surface = current ? window->eglSurface : EGL_NO_SURFACE;
+        if (!eglMakeCurrent(window->eglDisplay, surface, surface, current ? window->eglContext : EGL_NO_CONTEXT)) {
+            fprintf(stderr, "Failed to %s the EGL context (0x%x)\n", current ? "take" : "release", eglGetError());
+            return false;
+        }
+#endif
+        return true;
+    }
+
+    if (!window->handle) return false;
+    glfwMakeContextCurrent(current ? window->handle : NULL);
+    return true;
+}
+
 bool window_should_close(Window *window)
 {
+    // only the caller decides when a batch run ends
+    if (window && window->headless) return false;
+
     return window && window->handle
         ? glfwWindowShouldClose(window->handle)
         : true;
 }
 
+bool window_save_ppm(Window *window, const char *path)
+{
+    if (!window) return false;
+
+    int w = window->width, h = window->height;
+    unsigned char *pixels = malloc((size_t)w * h * 3);
+    if (!pixels) return false;
+
+    // the window's back buffer holds the frame until it is swapped
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, window->framebuffer);
+    glReadBuffer(window->framebuffer ? GL_COLOR_ATTACHMENT0 : GL_BACK);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, w, h, GL_RGB, GL_UNSIGNED_BYTE, pixels);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        fprintf(stderr, "Cannot write %s\n", path);
+        free(pixels);
+        return false;
+    }
+
+    // PPM rows go top to bottom, GL rows bottom to top
+    fprintf(f, "P6\n%d %d\n255\n", w, h);
+    for (int y = h - 1; y >= 0; y--)
+        fwrite(pixels + (size_t)y * w * 3, 3, w, f);
+    fclose(f);
+    free(pixels);
+    return true;
+}
+
 void window_destroy(Window *window)
 {
     if (!window) return;
 
+    if (window->headless) {
+#ifdef __linux__
+        if (window->eglContext && eglGetCurrentContext() == window->eglContext) {
+            glDeleteFramebuffers(1, &window->framebuffer);
+            glDeleteRenderbuffers(1, &window->colorBuffer);
+            glDeleteRenderbuffers(1, &window->depthBuffer);
+        }
+        if (window->eglDisplay) {
+            eglMakeCurrent(window->eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+            if (window->eglSurface) eglDestroySurface(window->eglDisplay, window->eglSurface);
+            if (window->eglContext) eglDestroyContext(window->eglDisplay, window->eglContext);
+            eglTerminate(window->eglDisplay);
+        }
+#endif
+        window->framebuffer = 0;
+        window->eglDisplay = window->eglContext = window->eglSurface = NULL;
+        return;
+    }
+
     if (window->handle) {
         glfwDestroyWindow(window->handle);
         window->handle = NULL;
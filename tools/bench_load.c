@@ -0,0 +1,335 @@
+#define _POSIX_C_SOURCE 200809L // posix_fadvise, opendir
+#include <glad/glad.h>
+#include "jobs.h"
+#include "loadstats.h"
+#include "material.h"
+#include "model.h"
+#include "shader.h"
+#include "texture.h"
+#include "timing.h"
+#include "window.h"
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*
+
+   bench_load should only time how the engine loads its assets, stage by stage
+   it should NOT have its own loaders, it calls texture_load, model_load and
+   shader_load_variant and reads the stages they mark through loadstats
+
+   usage: bench_load [--runs n] [--json file] [--jobs n] [asset...]
+     asset: image (texture), .obj/.fbx/... (model) or vs.shdr+fs.shdr (shader)
+     without assets, the ones redbox loads at startup
+     --jobs: job worker threads, one per core by default, 0 decodes inline
+
+   every run loads everything twice: cold, after asking the kernel to drop the
+   files from the page cache, then warm. each load starts from empty material
+   and shader caches. shader program binaries (.shadercache/) are left alone,
+   delete the directory for compile times
+
+   OWNS: a headless GL context, per-run records
+
+   input: asset paths
+   output: median stage times and MB/s per asset, cold and warm
+
+*/
+
+#define MAX_ASSETS 32
+#define MAX_RUNS 64
+#define MAX_KEYS 128            // distinct (kind, path) records, nested loads included
+
+typedef enum { ASSET_TEXTURE, ASSET_MODEL, ASSET_SHADER } AssetKind;
+
+typedef struct {
+    AssetKind kind;
+    char path[256];
+    char fragPath[256];         // shaders
+} Asset;
+
+typedef struct {
+    char kind[16];
+    char path[256];
+    int depth;
+    int64_t bytes;
+    double stageMs[2][MAX_RUNS][LOAD_STAGE_COUNT];  // [cold, warm][run][stage]
+    double totalMs[2][MAX_RUNS];
+    int runs[2];
+} Timing;
+
+static Timing timings[MAX_KEYS];
+static int timingCount = 0;
+
+static const char* surfaceVert = "shaders/vs_surface.shdr";
+static const char* surfaceFrag = "shaders/fs_surface.shdr";
+
+static const char* defaultAssets[] = {
+    "assets/grass.png",
+    "assets/wall.jpg",
+    "assets/cube.png",
+    "assets/source/Chair_Pack/Chair_Pack.fbx",
+    "shaders/vs_surface.shdr+shaders/fs_surface.shdr",
+};
+
+static bool parse_asset(Asset* asset, const char* arg) {
+    memset(asset, 0, sizeof(*asset));
+    const char* plus = strchr(arg, '+');
+    if (plus) {
+        asset->kind = ASSET_SHADER;
+        snprintf(asset->path, sizeof(asset->path), "%.*s", (int)(plus - arg), arg);
+        snprintf(asset->fragPath, sizeof(asset->fragPath), "%s", plus + 1);
+        return true;
+    }
+
+    snprintf(asset->path, sizeof(asset->path), "%s", arg);
+    const char* dot = strrchr(arg, '.');
+    const char* images[] = { ".png", ".jpg", ".jpeg", ".tga", ".bmp", ".hdr", ".psd" };
+    asset->kind = ASSET_MODEL;
+    for (size_t i = 0; dot && i < sizeof(images) / sizeof(images[0]); i++)
+        if (strcmp(dot, images[i]) == 0) asset->kind = ASSET_TEXTURE;
+    return true;
+}
+
+// drop clean pages of the file from the page cache, no root needed
+static void evict_file(const char* path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return;
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+}
+
+// a model pulls in materials and textures next to it
+static void evict_directory(const char* dir, int depth) {
+    DIR* d = opendir(dir);
+    if (!d) return;
+    struct dirent* entry;
+    while ((entry = readdir(d))) {
+        if (entry->d_name[0] == '.') continue;
+        char path[512];
+        snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name);
+        struct stat st;
+        if (stat(path, &st) != 0) continue;
+        if (S_ISDIR(st.st_mode) && depth < 4)
+            evict_directory(path, depth + 1);
+        else if (S_ISREG(st.st_mode))
+            evict_file(path);
+    }
+    closedir(d);
+}
+
+static void evict_asset(const Asset* asset) {
+    if (asset->kind == ASSET_MODEL) {
+        char dir[256];
+        const char* slash = strrchr(asset->path, '/');
+        snprintf(dir, sizeof(dir), "%.*s", slash ? (int)(slash - asset->path) : 1, slash ? asset->path : ".");
+        evict_directory(dir, 0);
+    } else if (asset->kind == ASSET_SHADER) {
+        // includes sit next to the stages
+        char dir[256];
+        const char* slash = strrchr(asset->fragPath, '/');
+        snprintf(dir, sizeof(dir), "%.*s", slash ? (int)(slash - asset->fragPath) : 1,
+                 slash ? asset->fragPath : ".");
+        evict_directory(dir, 0);
+        evict_file(asset->path);
+    } else {
+        evict_file(asset->path);
+    }
+}
+
+static bool load_asset(const Asset* asset) {
+    switch (asset->kind) {
+    case ASSET_TEXTURE: {
+        Texture texture;
+        if (!texture_load(&texture, asset->path)) return false;
+        texture_destroy(&texture);
+        return true;
+    }
+    case ASSET_MODEL: {
+        Model model;
+        if (!model_load(&model, asset->path)) return false;
+        model_destroy(&model);
+        return true;
+    }
+    case ASSET_SHADER: {
+        Shader shader;
+        if (!shader_load_variant(&shader, asset->path, asset->fragPath, 0)) return false;
+        shader_destroy(&shader);
+        return true;
+    }
+    }
+    return false;
+}
+
+static Timing* find_timing(const LoadRecord* r) {
+    for (int i = 0; i < timingCount; i++)
+        if (strcmp(timings[i].kind, r->kind) == 0 && strcmp(timings[i].path, r->path) == 0) return &timings[i];
+    if (timingCount == MAX_KEYS) return NULL;
+
+    Timing* t = &timings[timingCount++];
+    memset(t, 0, sizeof(*t));
+    snprintf(t->kind, sizeof(t->kind), "%s", r->kind);
+    snprintf(t->path, sizeof(t->path), "%s", r->path);
+    t->depth = r->depth;
+    t->bytes = r->bytes;
+    return t;
+}
+
+// one pass over every asset, from empty engine caches
+static bool run_pass(const Asset* assets, int assetCount, int phase) {
+    if (!material_system_init(surfaceVert, surfaceFrag)) return false;
+    shader_finish_pending();
+
+    bool ok = true;
+    loadstats_clear();
+    loadstats_enable(true);
+    for (int i = 0; i < assetCount; i++) {
+        if (phase == 0) evict_asset(&assets[i]);
+        if (!load_asset(&assets[i])) ok = false;
+    }
+    loadstats_enable(false);
+
+    for (int i = 0; i < loadstats_count(); i++) {
+        const LoadRecord* r = loadstats_at(i);
+        Timing* t = find_timing(r);
+        // the same texture can be loaded twice in a pass by different assets
+        if (!t || t->runs[phase] == MAX_RUNS) continue;
+        int run = t->runs[phase]++;
+        memcpy(t->stageMs[phase][run], r->stageMs, sizeof(r->stageMs));
+        t->totalMs[phase][run] = r->totalMs;
+    }
+
+    material_system_shutdown();
+    shader_cache_shutdown();
+    return ok;
+}
+
+static int compare_double(const void* a, const void* b) {
+    double da = *(const double*)a, db = *(const double*)b;
+    return da < db ? -1 : (da > db);
+}
+
+static double median(const double* values, int count) {
+    double sorted[MAX_RUNS];
+    memcpy(sorted, values, sizeof(double) * count);
+    qsort(sorted, count, sizeof(double), compare_double);
+    return count ? sorted[count / 2] : 0.0;
+}
+
+static double stage_median(const Timing* t, int phase, int stage) {
+    double values[MAX_RUNS];
+    for (int i = 0; i < t->runs[phase]; i++) values[i] = t->stageMs[phase][i][stage];
+    return median(values, t->runs[phase]);
+}
+
+static void print_phase(int phase, int runs) {
+    printf("%s, median of %d runs, ms\n", phase == 0 ? "cold (page cache dropped)" : "warm", runs);
+    printf("  %-15s %-44s %7s", "kind", "asset", "MB");
+    for (int s = 0; s < LOAD_STAGE_COUNT; s++) printf(" %8s", loadstats_stage_name((LoadStage)s));
+    printf(" %9s %8s\n", "total", "MB/s");
+
+    for (int i = 0; i < timingCount; i++) {
+        const Timing* t = &timings[i];
+        if (t->runs[phase] == 0) continue;
+
+        // nested loads are indented under the asset that pulled them in
+        char name[300];
+        const char* path = t->path;
+        size_t length = strlen(path);
+        if (length > 40 - 2 * (size_t)t->depth) path += length - (40 - 2 * t->depth);
+        snprintf(name, sizeof(name), "%*s%s%s", 2 * t->depth, "", path == t->path ? "" : "..", path);
+
+        double total = median(t->totalMs[phase], t->runs[phase]);
+        double mb = t->bytes / (1024.0 * 1024.0);
+        printf("  %-15s %-44s %7.2f", t->kind, name, mb);
+        for (int s = 0; s < LOAD_STAGE_COUNT; s++) printf(" %8.2f", stage_median(t, phase, s));
+        printf(" %9.2f %8.1f\n", total, total > 0.0 ? mb / (total / 1000.0) : 0.0);
+    }
+    printf("\n");
+}
+
+static bool write_json(const char* path, int runs) {
+    FILE* f = fopen(path, "w");
+    if (!f) {
+        fprintf(stderr, "Cannot write %s\n", path);
+        return false;
+    }
+
+    fprintf(f, "{\n  \"runs\": %d,\n  \"renderer\": \"%s\",\n  \"assets\": [\n", runs,
+            (const char*)glGetString(GL_RENDERER));
+    for (int i = 0; i < timingCount; i++) {
+        const Timing* t = &timings[i];
+        fprintf(f, "    {\"kind\": \"%s\", \"path\": \"%s\", \"depth\": %d, \"bytes\": %lld", t->kind, t->path,
+                t->depth, (long long)t->bytes);
+        for (int phase = 0; phase < 2; phase++) {
+            fprintf(f, ", \"%s\": {", phase == 0 ? "cold" : "warm");
+            for (int s = 0; s < LOAD_STAGE_COUNT; s++)
+                fprintf(f, "\"%sMs\": %.3f, ", loadstats_stage_name((LoadStage)s), stage_median(t, phase, s));
+            fprintf(f, "\"totalMs\": %.3f}", median(t->totalMs[phase], t->runs[phase]));
+        }
+        fprintf(f, "}%s\n", i + 1 < timingCount ? "," : "");
+    }
+    fprintf(f, "  ]\n}\n");
+    fclose(f);
+    return true;
+}
+
+int main(int argc, char** argv) {
+    int runs = 5;
+    int workers = -1;
+    const char* jsonPath = NULL;
+    static Asset assets[MAX_ASSETS];
+    int assetCount = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--runs") == 0 && i + 1 < argc) {
+            runs = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            jsonPath = argv[++i];
+        } else if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc) {
+            workers = atoi(argv[++i]);
+        } else if (argv[i][0] == '-') {
+            fprintf(stderr, "usage: bench_load [--runs n] [--json file] [--jobs n] [asset...]\n");
+            return 2;
+        } else if (assetCount < MAX_ASSETS) {
+            parse_asset(&assets[assetCount++], argv[i]);
+        }
+    }
+    if (runs < 1 || runs > MAX_RUNS) {
+        fprintf(stderr, "--runs takes 1 to %d\n", MAX_RUNS);
+        return 2;
+    }
+    if (assetCount == 0) {
+        for (size_t i = 0; i < sizeof(defaultAssets) / sizeof(defaultAssets[0]); i++)
+            parse_asset(&assets[assetCount++], defaultAssets[i]);
+    }
+
+    // a tiny offscreen context, nothing is drawn
+    Window window;
+    window_hint_headless(true);
+    if (!window_create(&window, 64, 64, "bench_load")) return 1;
+    if (!jobs_init(workers)) return 1;
+
+    double begin = time_now();
+    bool ok = true;
+    for (int run = 0; run < runs; run++) {
+        ok &= run_pass(assets, assetCount, 0);
+        ok &= run_pass(assets, assetCount, 1);
+    }
+    if (!ok) fprintf(stderr, "Some assets failed to load, their rows are incomplete\n");
+
+    ShaderCacheStats shaderStats = shader_cache_stats();
+    printf("%d assets, %d cold and %d warm passes in %.1f s, %d shader binaries from the cache\n\n", assetCount,
+           runs, runs, time_now() - begin, shaderStats.binaryHits);
+    print_phase(0, runs);
+    print_phase(1, runs);
+
+    if (jsonPath && write_json(jsonPath, runs)) printf("Wrote %s\n", jsonPath);
+
+    jobs_shutdown();
+    window_destroy(&window);
+    return ok ? 0 : 1;
+}
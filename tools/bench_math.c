@@ -0,0 +1,649 @@
+#define _POSIX_C_SOURCE 200809L // clock_gettime
+#define CGLM_ALL_UNALIGNED      // glmm_load is loadu, so the same code runs on offset data
+#include <cglm/cglm.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/*
+
+   bench_math should only time the cglm operations the engine runs in bulk
+   it should NOT decide how the engine calls them, it says what each path costs
+   per element so batching and SoA layouts can be judged by numbers
+
+   usage: bench_math [--batch n,n,...] [--samples n] [--json file]
+
+   kernels: mat4 multiply, mat4 inverse, TRS compose, vec3 transform, AABB
+   transform and AABB/frustum tests. each has a plain C variant (the scalar
+   code cglm falls back to) next to the include/cglm/simd paths compiled in:
+   sse2 with SSE2, avx with -mavx. SoA variants transform 4 or 8 elements at
+   a time from separate x/y/z arrays. cglm has no SIMD AABB code, those SIMD
+   variants are ours, written with its glmm_ helpers
+
+   every variant runs on 64 byte aligned data and on the same data 4 bytes
+   off, at every batch size: 16 fits in L1, 65536 matrices do not fit in L2.
+   the times are ns per element, the median over samples of 2^19 elements
+
+   the engine builds without -O or -march, this tool builds with -O2 and
+   MATH_ARCH (-march=native by default), so it shows what the flags would buy.
+   the plain C variants are what the compiler makes of them at those flags,
+   which may already be vectorized
+
+   OWNS: input and output batches, timings
+
+   input: batch sizes
+   output: a table per kernel on stdout, optionally JSON
+
+*/
+
+#define MAX_BATCHES 8
+#define MAX_SAMPLES 64
+#define SAMPLE_ELEMENTS (1 << 19)
+#define CHECK_COUNT 1001        // odd, so the SoA loops run their tails
+#define UNALIGNED_OFFSET 4      // bytes, every mat4 then straddles a cache line
+
+// one batch of inputs and outputs, every array `count` elements long
+typedef struct {
+    int count;
+    mat4* m1;
+    mat4* m2;
+    mat4* mOut;
+    float* trs;                 // position xyz, angle, scale xyz per element
+    vec3* points;
+    vec3* pointsOut;
+    float* soa[3];              // the same points as x, y and z arrays
+    float* soaOut[3];
+    vec3 (*boxes)[2];
+    vec3 (*boxesOut)[2];
+    float* boxSoa[6];           // the same boxes as min xyz, max xyz arrays
+    int* visible;
+    vec4 planes[6];
+
+    void* blocks[32];           // what to free
+    int blockCount;
+} Batch;
+
+typedef void (*KernelFn)(Batch* b, int n);
+typedef double (*SumFn)(const Batch* b, int n);
+
+typedef struct {
+    const char* kernel;
+    const char* variant;
+    KernelFn run;
+    SumFn sum;                  // layout independent checksum of the outputs
+    double tolerance;           // relative, against the kernel's first variant
+} Variant;
+
+// ---------------------------------------------------------------------------
+// Data
+// ---------------------------------------------------------------------------
+
+// xorshift32, the same batches on every machine
+static float random_range(uint32_t* state, float lo, float hi) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return lo + (hi - lo) * ((float)(x >> 8) / (float)(1u << 24));
+}
+
+static void* batch_alloc(Batch* b, size_t bytes, int offset) {
+    char* block = aligned_alloc(64, (bytes + 64 + 63) / 64 * 64);
+    if (!block) {
+        fprintf(stderr, "Out of memory for a batch of %d\n", b->count);
+        exit(1);
+    }
+    memset(block, 0, bytes + 64);
+    b->blocks[b->blockCount++] = block;
+    return block + offset;
+}
+
+static void make_trs(mat4 m, const float* trs) {
+    glm_mat4_identity(m);
+    glm_translate(m, (vec3){ trs[0], trs[1], trs[2] });
+    glm_rotate_y(m, trs[3], m);
+    glm_scale(m, (vec3){ trs[4], trs[5], trs[6] });
+}
+
+static void batch_create(Batch* b, int count, int offset) {
+    memset(b, 0, sizeof(*b));
+    b->count = count;
+    b->m1 = batch_alloc(b, sizeof(mat4) * count, offset);
+    b->m2 = batch_alloc(b, sizeof(mat4) * count, offset);
+    b->mOut = batch_alloc(b, sizeof(mat4) * count, offset);
+    b->trs = batch_alloc(b, sizeof(float) * 7 * count, offset);
+    b->points = batch_alloc(b, sizeof(vec3) * count, offset);
+    b->pointsOut = batch_alloc(b, sizeof(vec3) * count, offset);
+    for (int i = 0; i < 3; i++) {
+        b->soa[i] = batch_alloc(b, sizeof(float) * count, offset);
+        b->soaOut[i] = batch_alloc(b, sizeof(float) * count, offset);
+    }
+    b->boxes = batch_alloc(b, sizeof(vec3[2]) * count, offset);
+    b->boxesOut = batch_alloc(b, sizeof(vec3[2]) * count, offset);
+    for (int i = 0; i < 6; i++) b->boxSoa[i] = batch_alloc(b, sizeof(float) * count, offset);
+    b->visible = batch_alloc(b, sizeof(int) * count, offset);
+
+    // well conditioned transforms, like the ones the scenes build
+    uint32_t rng = 1;
+    for (int i = 0; i < count; i++) {
+        float* trs = &b->trs[i * 7];
+        for (int k = 0; k < 3; k++) trs[k] = random_range(&rng, -20.0f, 20.0f);
+        trs[3] = random_range(&rng, 0.0f, 2.0f * GLM_PIf);
+        for (int k = 4; k < 7; k++) trs[k] = random_range(&rng, 0.5f, 2.0f);
+        make_trs(b->m1[i], trs);
+        make_trs(b->m2[i], (float[7]){ trs[1], trs[2], trs[0], -trs[3], trs[6], trs[4], trs[5] });
+
+        for (int k = 0; k < 3; k++) {
+            b->points[i][k] = b->soa[k][i] = random_range(&rng, -1.0f, 1.0f);
+            float center = random_range(&rng, -20.0f, 20.0f), extent = random_range(&rng, 0.1f, 1.0f);
+            b->boxes[i][0][k] = b->boxSoa[k][i] = center - extent;
+            b->boxes[i][1][k] = b->boxSoa[k + 3][i] = center + extent;
+        }
+    }
+
+    // a 60 degree camera at the origin looking down -Z, about a sixth of the boxes in view
+    mat4 projection, view, viewProjection;
+    glm_perspective(glm_rad(60.0f), 16.0f / 9.0f, 0.1f, 100.0f, projection);
+    glm_lookat((vec3){ 0.0f, 0.0f, 0.0f }, (vec3){ 0.0f, 0.0f, -1.0f }, (vec3){ 0.0f, 1.0f, 0.0f }, view);
+    glm_mat4_mul(projection, view, viewProjection);
+    glm_frustum_planes(viewProjection, b->planes);
+}
+
+static void batch_destroy(Batch* b) {
+    for (int i = 0; i < b->blockCount; i++) free(b->blocks[i]);
+    memset(b, 0, sizeof(*b));
+}
+
+static void batch_clear_outputs(Batch* b) {
+    memset(b->mOut, 0, sizeof(mat4) * b->count);
+    memset(b->pointsOut, 0, sizeof(vec3) * b->count);
+    for (int i = 0; i < 3; i++) memset(b->soaOut[i], 0, sizeof(float) * b->count);
+    memset(b->boxesOut, 0, sizeof(vec3[2]) * b->count);
+    memset(b->visible, 0, sizeof(int) * b->count);
+}
+
+static double sum_floats(const float* values, int count) {
+    double sum = 0.0;
+    for (int i = 0; i < count; i++) sum += values[i];
+    return sum;
+}
+
+static double sum_matrices(const Batch* b, int n) { return sum_floats(b->mOut[0][0], n * 16); }
+static double sum_points(const Batch* b, int n) { return sum_floats(b->pointsOut[0], n * 3); }
+static double sum_boxes(const Batch* b, int n) { return sum_floats(b->boxesOut[0][0], n * 6); }
+
+static double sum_points_soa(const Batch* b, int n) {
+    return sum_floats(b->soaOut[0], n) + sum_floats(b->soaOut[1], n) + sum_floats(b->soaOut[2], n);
+}
+
+static double sum_visible(const Batch* b, int n) {
+    double sum = 0.0;
+    for (int i = 0; i < n; i++) sum += b->visible[i];
+    return sum;
+}
+
+// ---------------------------------------------------------------------------
+// Kernels
+// ---------------------------------------------------------------------------
+
+// cglm's plain C fallbacks, kept verbatim so the SIMD build can time them
+
+static void mat4_mul_scalar(mat4 m1, mat4 m2, mat4 dest) {
+    float a00 = m1[0][0], a01 = m1[0][1], a02 = m1[0][2], a03 = m1[0][3],
+          a10 = m1[1][0], a11 = m1[1][1], a12 = m1[1][2], a13 = m1[1][3],
+          a20 = m1[2][0], a21 = m1[2][1], a22 = m1[2][2], a23 = m1[2][3],
+          a30 = m1[3][0], a31 = m1[3][1], a32 = m1[3][2], a33 = m1[3][3],
+
+          b00 = m2[0][0], b01 = m2[0][1], b02 = m2[0][2], b03 = m2[0][3],
+          b10 = m2[1][0], b11 = m2[1][1], b12 = m2[1][2], b13 = m2[1][3],
+          b20 = m2[2][0], b21 = m2[2][1], b22 = m2[2][2], b23 = m2[2][3],
+          b30 = m2[3][0], b31 = m2[3][1], b32 = m2[3][2], b33 = m2[3][3];
+
+    dest[0][0] = a00 * b00 + a10 * b01 + a20 * b02 + a30 * b03;
+    dest[0][1] = a01 * b00 + a11 * b01 + a21 * b02 + a31 * b03;
+    dest[0][2] = a02 * b00 + a12 * b01 + a22 * b02 + a32 * b03;
+    dest[0][3] = a03 * b00 + a13 * b01 + a23 * b02 + a33 * b03;
+    dest[1][0] = a00 * b10 + a10 * b11 + a20 * b12 + a30 * b13;
+    dest[1][1] = a01 * b10 + a11 * b11 + a21 * b12 + a31 * b13;
+    dest[1][2] = a02 * b10 + a12 * b11 + a22 * b12 + a32 * b13;
+    dest[1][3] = a03 * b10 + a13 * b11 + a23 * b12 + a33 * b13;
+    dest[2][0] = a00 * b20 + a10 * b21 + a20 * b22 + a30 * b23;
+    dest[2][1] = a01 * b20 + a11 * b21 + a21 * b22 + a31 * b23;
+    dest[2][2] = a02 * b20 + a12 * b21 + a22 * b22 + a32 * b23;
+    dest[2][3] = a03 * b20 + a13 * b21 + a23 * b22 + a33 * b23;
+    dest[3][0] = a00 * b30 + a10 * b31 + a20 * b32 + a30 * b33;
+    dest[3][1] = a01 * b30 + a11 * b31 + a21 * b32 + a31 * b33;
+    dest[3][2] = a02 * b30 + a12 * b31 + a22 * b32 + a32 * b33;
+    dest[3][3] = a03 * b30 + a13 * b31 + a23 * b32 + a33 * b33;
+}
+
+static void mat4_inv_scalar(mat4 mat, mat4 dest) {
+    float a = mat[0][0], b = mat[0][1], c = mat[0][2], d = mat[0][3],
+          e = mat[1][0], f = mat[1][1], g = mat[1][2], h = mat[1][3],
+          i = mat[2][0], j = mat[2][1], k = mat[2][2], l = mat[2][3],
+          m = mat[3][0], n = mat[3][1], o = mat[3][2], p = mat[3][3],
+
+          c1  = k * p - l * o,  c2  = c * h - d * g,  c3  = i * p - l * m,
+          c4  = a * h - d * e,  c5  = j * p - l * n,  c6  = b * h - d * f,
+          c7  = i * n - j * m,  c8  = a * f - b * e,  c9  = j * o - k * n,
+          c10 = b * g - c * f,  c11 = i * o - k * m,  c12 = a * g - c * e,
+
+          idt = 1.0f / (c8 * c1 + c4 * c9 + c10 * c3 + c2 * c7 - c12 * c5 - c6 * c11), ndt = -idt;
+
+    dest[0][0] = (f * c1  - g * c5  + h * c9)  * idt;
+    dest[0][1] = (b * c1  - c * c5  + d * c9)  * ndt;
+    dest[0][2] = (n * c2  - o * c6  + p * c10) * idt;
+    dest[0][3] = (j * c2  - k * c6  + l * c10) * ndt;
+
+    dest[1][0] = (e * c1  - g * c3  + h * c11) * ndt;
+    dest[1][1] = (a * c1  - c * c3  + d * c11) * idt;
+    dest[1][2] = (m * c2  - o * c4  + p * c12) * ndt;
+    dest[1][3] = (i * c2  - k * c4  + l * c12) * idt;
+
+    dest[2][0] = (e * c5  - f * c3  + h * c7)  * idt;
+    dest[2][1] = (a * c5  - b * c3  + d * c7)  * ndt;
+    dest[2][2] = (m * c6  - n * c4  + p * c8)  * idt;
+    dest[2][3] = (i * c6  - j * c4  + l * c8)  * ndt;
+
+    dest[3][0] = (e * c9  - f * c11 + g * c7)  * ndt;
+    dest[3][1] = (a * c9  - b * c11 + c * c7)  * idt;
+    dest[3][2] = (m * c10 - n * c12 + o * c8)  * ndt;
+    dest[3][3] = (i * c10 - j * c12 + k * c8)  * idt;
+}
+
+static void mul_scalar(Batch* b, int n) {
+    for (int i = 0; i < n; i++) mat4_mul_scalar(b->m1[i], b->m2[i], b->mOut[i]);
+}
+
+static void inv_scalar(Batch* b, int n) {
+    for (int i = 0; i < n; i++) mat4_inv_scalar(b->m1[i], b->mOut[i]);
+}
+
+// what stress.c and main.c do per object
+static void trs_cglm(Batch* b, int n) {
+    for (int i = 0; i < n; i++) make_trs(b->mOut[i], &b->trs[i * 7]);
+}
+
+// the same matrix written out, no multiplies by identity
+static void trs_direct(Batch* b, int n) {
+    for (int i = 0; i < n; i++) {
+        const float* trs = &b->trs[i * 7];
+        float c = cosf(trs[3]), s = sinf(trs[3]);
+        float* m = b->mOut[i][0];
+        m[0] = c * trs[4];  m[1] = 0.0f;    m[2] = -s * trs[4]; m[3] = 0.0f;
+        m[4] = 0.0f;        m[5] = trs[5];  m[6] = 0.0f;        m[7] = 0.0f;
+        m[8] = s * trs[6];  m[9] = 0.0f;    m[10] = c * trs[6]; m[11] = 0.0f;
+        m[12] = trs[0];     m[13] = trs[1]; m[14] = trs[2];     m[15] = 1.0f;
+    }
+}
+
+// every point by the first matrix, as when baking a mesh into world space
+static void points_scalar(Batch* b, int n) {
+    float (*m)[4] = b->m1[0];
+    for (int i = 0; i < n; i++) {
+        const float* p = b->points[i];
+        for (int r = 0; r < 3; r++)
+            b->pointsOut[i][r] = m[0][r] * p[0] + m[1][r] * p[1] + m[2][r] * p[2] + m[3][r];
+    }
+}
+
+static void points_soa_scalar(Batch* b, int n) {
+    float (*m)[4] = b->m1[0];
+    const float *x = b->soa[0], *y = b->soa[1], *z = b->soa[2];
+    for (int r = 0; r < 3; r++) {
+        float* out = b->soaOut[r];
+        for (int i = 0; i < n; i++) out[i] = m[0][r] * x[i] + m[1][r] * y[i] + m[2][r] * z[i] + m[3][r];
+    }
+}
+
+static void aabb_cglm(Batch* b, int n) {
+    for (int i = 0; i < n; i++) glm_aabb_transform(b->boxes[i], b->m1[i], b->boxesOut[i]);
+}
+
+static void frustum_cglm(Batch* b, int n) {
+    for (int i = 0; i < n; i++) b->visible[i] = glm_aabb_frustum(b->boxes[i], b->planes);
+}
+
+#if defined(CGLM_SSE2_FP)
+
+static void mul_sse2(Batch* b, int n) {
+    for (int i = 0; i < n; i++) glm_mat4_mul_sse2(b->m1[i], b->m2[i], b->mOut[i]);
+}
+
+static void inv_sse2(Batch* b, int n) {
+    for (int i = 0; i < n; i++) glm_mat4_inv_sse2(b->m1[i], b->mOut[i]);
+}
+
+static void points_sse2(Batch* b, int n) {
+    for (int i = 0; i < n; i++) {
+        vec4 p = { b->points[i][0], b->points[i][1], b->points[i][2], 1.0f };
+        glm_mat4_mulv_sse2(b->m1[0], p, p);
+        glm_vec3_copy(p, b->pointsOut[i]);
+    }
+}
+
+// four points per step, one broadcast matrix element per multiply
+static void points_soa_sse2(Batch* b, int n) {
+    float (*m)[4] = b->m1[0];
+    const float *x = b->soa[0], *y = b->soa[1], *z = b->soa[2];
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 px = _mm_loadu_ps(x + i), py = _mm_loadu_ps(y + i), pz = _mm_loadu_ps(z + i);
+        for (int r = 0; r < 3; r++) {
+            __m128 v = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(m[0][r]), px), _mm_mul_ps(_mm_set1_ps(m[1][r]), py));
+            v = _mm_add_ps(v, _mm_add_ps(_mm_mul_ps(_mm_set1_ps(m[2][r]), pz), _mm_set1_ps(m[3][r])));
+            _mm_storeu_ps(b->soaOut[r] + i, v);
+        }
+    }
+    for (; i < n; i++)
+        for (int r = 0; r < 3; r++)
+            b->soaOut[r][i] = m[0][r] * x[i] + m[1][r] * y[i] + m[2][r] * z[i] + m[3][r];
+}
+
+// glm_aabb_transform with whole columns: min/max of each column scaled by the
+// box's min and max, summed onto the translation
+static void aabb_sse2(Batch* b, int n) {
+    for (int i = 0; i < n; i++) {
+        float (*m)[4] = b->m1[i];
+        vec3* box = b->boxes[i];
+        __m128 lo = glmm_load(m[3]), hi = lo;
+        for (int c = 0; c < 3; c++) {
+            __m128 column = glmm_load(m[c]);
+            __m128 a = _mm_mul_ps(column, _mm_set1_ps(box[0][c]));
+            __m128 z = _mm_mul_ps(column, _mm_set1_ps(box[1][c]));
+            lo = _mm_add_ps(lo, _mm_min_ps(a, z));
+            hi = _mm_add_ps(hi, _mm_max_ps(a, z));
+        }
+        glmm_store3(b->boxesOut[i][0], lo);
+        glmm_store3(b->boxesOut[i][1], hi);
+    }
+}
+
+// glm_aabb_frustum on four boxes at once, the plane picks the corner per axis
+static void frustum_soa_sse2(Batch* b, int n) {
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 outside = _mm_setzero_ps();
+        for (int p = 0; p < 6; p++) {
+            const float* plane = b->planes[p];
+            __m128 dp = _mm_setzero_ps();
+            for (int k = 0; k < 3; k++) {
+                const float* corner = b->boxSoa[plane[k] > 0.0f ? k + 3 : k];
+                dp = _mm_add_ps(dp, _mm_mul_ps(_mm_set1_ps(plane[k]), _mm_loadu_ps(corner + i)));
+            }
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(dp, _mm_set1_ps(-plane[3])));
+        }
+        int mask = _mm_movemask_ps(outside);
+        for (int k = 0; k < 4; k++) b->visible[i + k] = !(mask & (1 << k));
+    }
+    for (; i < n; i++) b->visible[i] = glm_aabb_frustum(b->boxes[i], b->planes);
+}
+
+#endif
+
+#if defined(__AVX__)
+
+static void mul_avx(Batch* b, int n) {
+    for (int i = 0; i < n; i++) glm_mat4_mul_avx(b->m1[i], b->m2[i], b->mOut[i]);
+}
+
+static void points_soa_avx(Batch* b, int n) {
+    float (*m)[4] = b->m1[0];
+    const float *x = b->soa[0], *y = b->soa[1], *z = b->soa[2];
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 px = _mm256_loadu_ps(x + i), py = _mm256_loadu_ps(y + i), pz = _mm256_loadu_ps(z + i);
+        for (int r = 0; r < 3; r++) {
+            __m256 v = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(m[0][r]), px),
+                                     _mm256_mul_ps(_mm256_set1_ps(m[1][r]), py));
+            v = _mm256_add_ps(v, _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(m[2][r]), pz), _mm256_set1_ps(m[3][r])));
+            _mm256_storeu_ps(b->soaOut[r] + i, v);
+        }
+    }
+    for (; i < n; i++)
+        for (int r = 0; r < 3; r++)
+            b->soaOut[r][i] = m[0][r] * x[i] + m[1][r] * y[i] + m[2][r] * z[i] + m[3][r];
+}
+
+static void frustum_soa_avx(Batch* b, int n) {
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 outside = _mm256_setzero_ps();
+        for (int p = 0; p < 6; p++) {
+            const float* plane = b->planes[p];
+            __m256 dp = _mm256_setzero_ps();
+            for (int k = 0; k < 3; k++) {
+                const float* corner = b->boxSoa[plane[k] > 0.0f ? k + 3 : k];
+                dp = _mm256_add_ps(dp, _mm256_mul_ps(_mm256_set1_ps(plane[k]), _mm256_loadu_ps(corner + i)));
+            }
+            outside = _mm256_or_ps(outside, _mm256_cmp_ps(dp, _mm256_set1_ps(-plane[3]), _CMP_LT_OQ));
+        }
+        int mask = _mm256_movemask_ps(outside);
+        for (int k = 0; k < 8; k++) b->visible[i + k] = !(mask & (1 << k));
+    }
+    for (; i < n; i++) b->visible[i] = glm_aabb_frustum(b->boxes[i], b->planes);
+}
+
+#endif
+
+// the first variant of each kernel is the reference the others are checked against
+static const Variant variants[] = {
+    { "mat4 multiply", "scalar", mul_scalar, sum_matrices, 1e-5 },
+#if defined(CGLM_SSE2_FP)
+    { "mat4 multiply", "sse2", mul_sse2, sum_matrices, 1e-5 },
+#endif
+#if defined(__AVX__)
+    { "mat4 multiply", "avx", mul_avx, sum_matrices, 1e-5 },
+#endif
+    { "mat4 inverse", "scalar", inv_scalar, sum_matrices, 1e-4 },
+#if defined(CGLM_SSE2_FP)
+    { "mat4 inverse", "sse2", inv_sse2, sum_matrices, 1e-4 },
+#endif
+    { "TRS compose", "cglm", trs_cglm, sum_matrices, 1e-5 },
+    { "TRS compose", "direct", trs_direct, sum_matrices, 1e-5 },
+    { "vec3 transform", "scalar", points_scalar, sum_points, 1e-5 },
+#if defined(CGLM_SSE2_FP)
+    { "vec3 transform", "sse2", points_sse2, sum_points, 1e-5 },
+#endif
+    { "vec3 transform", "soa scalar", points_soa_scalar, sum_points_soa, 1e-5 },
+#if defined(CGLM_SSE2_FP)
+    { "vec3 transform", "soa sse2", points_soa_sse2, sum_points_soa, 1e-5 },
+#endif
+#if defined(__AVX__)
+    { "vec3 transform", "soa avx", points_soa_avx, sum_points_soa, 1e-5 },
+#endif
+    { "AABB transform", "cglm", aabb_cglm, sum_boxes, 1e-5 },
+#if defined(CGLM_SSE2_FP)
+    { "AABB transform", "sse2", aabb_sse2, sum_boxes, 1e-5 },
+#endif
+    // boxes right on a plane may flip with FMA contraction of the C code
+    { "AABB frustum", "cglm", frustum_cglm, sum_visible, 0.01 },
+#if defined(CGLM_SSE2_FP)
+    { "AABB frustum", "soa sse2", frustum_soa_sse2, sum_visible, 0.01 },
+#endif
+#if defined(__AVX__)
+    { "AABB frustum", "soa avx", frustum_soa_avx, sum_visible, 0.01 },
+#endif
+};
+
+#define VARIANT_COUNT (int)(sizeof(variants) / sizeof(variants[0]))
+
+// ---------------------------------------------------------------------------
+// Timing
+// ---------------------------------------------------------------------------
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static int compare_double(const void* a, const void* b) {
+    double da = *(const double*)a, db = *(const double*)b;
+    return da < db ? -1 : (da > db);
+}
+
+static double time_variant(const Variant* v, Batch* b, int n, int samples) {
+    int repeats = SAMPLE_ELEMENTS / n > 0 ? SAMPLE_ELEMENTS / n : 1;
+    double ns[MAX_SAMPLES];
+
+    v->run(b, n); // caches and branch predictors warm
+    for (int s = 0; s < samples; s++) {
+        double begin = now_ns();
+        for (int r = 0; r < repeats; r++) v->run(b, n);
+        ns[s] = (now_ns() - begin) / ((double)repeats * n);
+    }
+    qsort(ns, samples, sizeof(double), compare_double);
+    return ns[samples / 2];
+}
+
+// every variant against its kernel's first, on the same inputs
+static bool check_variants(Batch* b) {
+    bool ok = true;
+    double reference = 0.0;
+    for (int i = 0; i < VARIANT_COUNT; i++) {
+        const Variant* v = &variants[i];
+        batch_clear_outputs(b);
+        v->run(b, b->count);
+        double sum = v->sum(b, b->count);
+        if (i == 0 || strcmp(v->kernel, variants[i - 1].kernel) != 0) {
+            reference = sum;
+            continue;
+        }
+        double scale = fabs(reference) > 1.0 ? fabs(reference) : 1.0;
+        if (fabs(sum - reference) > v->tolerance * scale) {
+            fprintf(stderr, "%s %s disagrees: checksum %.6g, %s has %.6g\n", v->kernel, v->variant, sum,
+                    variants[i - 1].variant, reference);
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+static int parse_batches(const char* list, int* batches) {
+    int count = 0;
+    for (const char* at = list; *at && count < MAX_BATCHES; at++) {
+        int n = atoi(at);
+        if (n < 1) return 0;
+        batches[count++] = n;
+        at = strchr(at, ',');
+        if (!at) break;
+    }
+    return count;
+}
+
+static void print_paths(void) {
+    printf("paths: scalar");
+#if defined(CGLM_SSE2_FP)
+    printf(" sse2");
+#endif
+#if defined(__AVX__)
+    printf(" avx");
+#endif
+#if defined(__FMA__)
+    printf(" (fma)");
+#endif
+    printf("\n");
+}
+
+static bool write_json(const char* path, const int* batches, int batchCount, int samples,
+                       double (*ns)[2][MAX_BATCHES]) {
+    FILE* f = fopen(path, "w");
+    if (!f) {
+        fprintf(stderr, "Cannot write %s\n", path);
+        return false;
+    }
+
+    fprintf(f, "{\n  \"samples\": %d,\n  \"batches\": [", samples);
+    for (int k = 0; k < batchCount; k++) fprintf(f, "%s%d", k ? ", " : "", batches[k]);
+    fprintf(f, "],\n  \"variants\": [\n");
+    for (int i = 0; i < VARIANT_COUNT; i++) {
+        for (int a = 0; a < 2; a++) {
+            fprintf(f, "    {\"kernel\": \"%s\", \"variant\": \"%s\", \"aligned\": %s, \"nsPerElement\": [",
+                    variants[i].kernel, variants[i].variant, a == 0 ? "true" : "false");
+            for (int k = 0; k < batchCount; k++) fprintf(f, "%s%.3f", k ? ", " : "", ns[i][a][k]);
+            fprintf(f, "]}%s\n", i + 1 < VARIANT_COUNT || a == 0 ? "," : "");
+        }
+    }
+    fprintf(f, "  ]\n}\n");
+    fclose(f);
+    return true;
+}
+
+int main(int argc, char** argv) {
+    int batches[MAX_BATCHES] = { 16, 256, 4096, 65536 };
+    int batchCount = 4;
+    int samples = 7;
+    const char* jsonPath = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc) {
+            batchCount = parse_batches(argv[++i], batches);
+        } else if (strcmp(argv[i], "--samples") == 0 && i + 1 < argc) {
+            samples = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            jsonPath = argv[++i];
+        } else {
+            fprintf(stderr, "usage: bench_math [--batch n,n,...] [--samples n] [--json file]\n");
+            return 2;
+        }
+    }
+    if (batchCount == 0 || samples < 1 || samples > MAX_SAMPLES) {
+        fprintf(stderr, "--batch takes up to %d sizes above 0, --samples 1 to %d\n", MAX_BATCHES, MAX_SAMPLES);
+        return 2;
+    }
+
+    int largest = CHECK_COUNT;
+    for (int k = 0; k < batchCount; k++) largest = batches[k] > largest ? batches[k] : largest;
+
+    // [aligned, unaligned], holding the same values
+    Batch data[2];
+    batch_create(&data[0], largest, 0);
+    batch_create(&data[1], largest, UNALIGNED_OFFSET);
+
+    Batch check;
+    batch_create(&check, CHECK_COUNT, 0);
+    bool ok = check_variants(&check);
+    batch_destroy(&check);
+
+    static double ns[VARIANT_COUNT][2][MAX_BATCHES];
+    for (int i = 0; i < VARIANT_COUNT; i++)
+        for (int a = 0; a < 2; a++)
+            for (int k = 0; k < batchCount; k++) ns[i][a][k] = time_variant(&variants[i], &data[a], batches[k], samples);
+
+    print_paths();
+    printf("ns per element, median of %d samples, (x) speed-up over the kernel's first variant\n", samples);
+    for (int i = 0; i < VARIANT_COUNT; i++) {
+        const Variant* v = &variants[i];
+        bool first = i == 0 || strcmp(v->kernel, variants[i - 1].kernel) != 0;
+        if (first) {
+            printf("\n%-26s", v->kernel);
+            for (int k = 0; k < batchCount; k++) printf(" %15d", batches[k]);
+            printf("\n");
+        }
+        int reference = i;
+        while (reference > 0 && strcmp(variants[reference - 1].kernel, v->kernel) == 0) reference--;
+
+        for (int a = 0; a < 2; a++) {
+            printf("  %-12s %-11s", v->variant, a == 0 ? "aligned" : "unaligned");
+            for (int k = 0; k < batchCount; k++) {
+                if (first)
+                    printf(" %15.2f", ns[i][a][k]);
+                else
+                    printf(" %8.2f (%4.1fx)", ns[i][a][k], ns[reference][a][k] / ns[i][a][k]);
+            }
+            printf("\n");
+        }
+    }
+    printf("\n");
+
+    if (jsonPath && write_json(jsonPath, batches, batchCount, samples, ns)) printf("Wrote %s\n", jsonPath);
+
+    batch_destroy(&data[0]);
+    batch_destroy(&data[1]);
+    return ok ? 0 : 1;
+}
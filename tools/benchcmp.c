@@ -0,0 +1,508 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+
+   benchcmp should only compare bench reports (redbox --bench --report) of a
+   baseline build against a candidate build
+   it should NOT run anything, collect the reports first
+
+   usage: benchcmp [--threshold pct] [--iterations n] [--seed n]
+                   baseline.json... --candidate candidate.json...
+
+   reports are grouped by scene. per-frame metrics (cpuMs, frameMs, gpuMs and
+   every GPU pass) compare their median and p95, per-run numbers (draw calls,
+   triangles, memory) their mean over runs. the confidence interval of each
+   relative change comes from a two level bootstrap: resample the runs, then
+   the frames inside each picked run, so run-to-run noise counts as well as
+   frame-to-frame noise
+
+   a change is a regression when it is worse than the threshold and the whole
+   95% interval is above zero. the exit status is 1 if anything regressed
+
+   OWNS: parsed reports, bootstrap samples
+
+   input: JSON reports
+   output: a table on stdout, exit status for a perf gate
+
+*/
+
+#define MAX_RUNS 64
+#define MAX_METRICS 64
+
+// ---------------------------------------------------------------------------
+// JSON, just enough for our own reports
+// ---------------------------------------------------------------------------
+
+typedef enum { JSON_NULL, JSON_BOOL, JSON_NUMBER, JSON_STRING, JSON_ARRAY, JSON_OBJECT } JsonType;
+
+typedef struct JsonValue {
+    JsonType type;
+    double number;
+    char* string;
+    char* key;                  // member name inside an object
+    struct JsonValue* items;    // array elements or object members
+    int count;
+} JsonValue;
+
+typedef struct {
+    const char* at;
+    const char* path;
+    bool failed;
+} JsonParser;
+
+static void json_error(JsonParser* p, const char* what) {
+    if (!p->failed) fprintf(stderr, "%s: %s near '%.16s'\n", p->path, what, p->at);
+    p->failed = true;
+}
+
+static void skip_space(JsonParser* p) {
+    while (*p->at == ' ' || *p->at == '\t' || *p->at == '\n' || *p->at == '\r') p->at++;
+}
+
+static char* parse_string(JsonParser* p) {
+    if (*p->at != '"') {
+        json_error(p, "expected a string");
+        return NULL;
+    }
+    p->at++;
+
+    size_t length = 0, capacity = 32;
+    char* out = malloc(capacity);
+    while (*p->at && *p->at != '"') {
+        char c = *p->at++;
+        if (c == '\\') {
+            c = *p->at++;
+            if (c == 'n') c = '\n';
+            else if (c == 't') c = '\t';
+            else if (c == 'u') { p->at += 4; c = '?'; } // our reports are ASCII
+        }
+        if (length + 1 == capacity) out = realloc(out, capacity *= 2);
+        out[length++] = c;
+    }
+    out[length] = '\0';
+    if (*p->at != '"') json_error(p, "unterminated string");
+    else p->at++;
+    return out;
+}
+
+static void parse_value(JsonParser* p, JsonValue* v);
+
+static JsonValue* push_item(JsonValue* v, int* capacity) {
+    if (v->count == *capacity) {
+        *capacity = *capacity ? *capacity * 2 : 8;
+        v->items = realloc(v->items, sizeof(JsonValue) * *capacity);
+    }
+    JsonValue* item = &v->items[v->count++];
+    memset(item, 0, sizeof(*item));
+    return item;
+}
+
+static void parse_container(JsonParser* p, JsonValue* v, char close) {
+    int capacity = 0;
+    p->at++;
+    skip_space(p);
+    if (*p->at == close) {
+        p->at++;
+        return;
+    }
+
+    while (!p->failed) {
+        skip_space(p);
+        JsonValue* item = push_item(v, &capacity);
+        if (v->type == JSON_OBJECT) {
+            item->key = parse_string(p);
+            skip_space(p);
+            if (*p->at != ':') {
+                json_error(p, "expected ':'");
+                return;
+            }
+            p->at++;
+        }
+        parse_value(p, item);
+        skip_space(p);
+
+        if (*p->at == ',') {
+            p->at++;
+        } else if (*p->at == close) {
+            p->at++;
+            return;
+        } else {
+            json_error(p, "expected ',' or a closing bracket");
+        }
+    }
+}
+
+static void parse_value(JsonParser* p, JsonValue* v) {
+    skip_space(p);
+    char c = *p->at;
+    if (c == '{') {
+        v->type = JSON_OBJECT;
+        parse_container(p, v, '}');
+    } else if (c == '[') {
+        v->type = JSON_ARRAY;
+        parse_container(p, v, ']');
+    } else if (c == '"') {
+        v->type = JSON_STRING;
+        v->string = parse_string(p);
+    } else if (strncmp(p->at, "true", 4) == 0 || strncmp(p->at, "false", 5) == 0) {
+        v->type = JSON_BOOL;
+        v->number = c == 't';
+        p->at += c == 't' ? 4 : 5;
+    } else if (strncmp(p->at, "null", 4) == 0) {
+        v->type = JSON_NULL;
+        p->at += 4;
+    } else {
+        char* end;
+        v->type = JSON_NUMBER;
+        v->number = strtod(p->at, &end);
+        if (end == p->at) json_error(p, "unexpected character");
+        p->at = end;
+    }
+}
+
+static void json_free(JsonValue* v) {
+    for (int i = 0; i < v->count; i++) json_free(&v->items[i]);
+    free(v->items);
+    free(v->string);
+    free(v->key);
+}
+
+static const JsonValue* json_get(const JsonValue* object, const char* key) {
+    if (!object || object->type != JSON_OBJECT) return NULL;
+    for (int i = 0; i < object->count; i++)
+        if (object->items[i].key && strcmp(object->items[i].key, key) == 0) return &object->items[i];
+    return NULL;
+}
+
+// ---------------------------------------------------------------------------
+// Reports
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    char name[64];
+    bool perFrame;              // values are frames, otherwise one value per run
+    double* values;
+    int count;
+} Metric;
+
+typedef struct {
+    const char* path;
+    char scene[128];
+    Metric metrics[MAX_METRICS];
+    int metricCount;
+} Run;
+
+static void add_metric(Run* run, const char* name, bool perFrame, const double* values, int count) {
+    if (run->metricCount == MAX_METRICS || count == 0) return;
+    Metric* m = &run->metrics[run->metricCount++];
+    snprintf(m->name, sizeof(m->name), "%s", name);
+    m->perFrame = perFrame;
+    m->values = malloc(sizeof(double) * count);
+    memcpy(m->values, values, sizeof(double) * count);
+    m->count = count;
+}
+
+static void add_frames(Run* run, const char* name, const JsonValue* times) {
+    const JsonValue* values = json_get(times, "values");
+    if (!values || values->type != JSON_ARRAY || values->count == 0) return;
+
+    double* frames = malloc(sizeof(double) * values->count);
+    for (int i = 0; i < values->count; i++) frames[i] = values->items[i].number;
+    add_metric(run, name, true, frames, values->count);
+    free(frames);
+}
+
+static void add_number(Run* run, const char* name, const JsonValue* v) {
+    if (v && v->type == JSON_NUMBER) add_metric(run, name, false, &v->number, 1);
+}
+
+static char* read_file(const char* path) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return NULL;
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char* text = malloc(size + 1);
+    if (text && fread(text, 1, size, f) != (size_t)size) {
+        free(text);
+        text = NULL;
+    }
+    if (text) text[size] = '\0';
+    fclose(f);
+    return text;
+}
+
+static bool load_run(Run* run, const char* path) {
+    memset(run, 0, sizeof(*run));
+    run->path = path;
+
+    char* text = read_file(path);
+    if (!text) {
+        fprintf(stderr, "Cannot read %s\n", path);
+        return false;
+    }
+
+    JsonParser parser = { text, path, false };
+    JsonValue root = { 0 };
+    parse_value(&parser, &root);
+    free(text);
+    if (parser.failed || root.type != JSON_OBJECT) {
+        if (!parser.failed) fprintf(stderr, "%s is not a bench report\n", path);
+        json_free(&root);
+        return false;
+    }
+
+    const JsonValue* scene = json_get(&root, "scene");
+    snprintf(run->scene, sizeof(run->scene), "%s", scene && scene->string ? scene->string : "room");
+
+    add_frames(run, "cpuMs", json_get(&root, "cpuMs"));
+    add_frames(run, "frameMs", json_get(&root, "frameMs"));
+    add_frames(run, "gpuMs", json_get(&root, "gpuMs"));
+
+    const JsonValue* passes = json_get(&root, "passes");
+    for (int i = 0; passes && i < passes->count; i++) {
+        char name[64];
+        snprintf(name, sizeof(name), "pass %s", passes->items[i].key);
+        add_frames(run, name, &passes->items[i]);
+    }
+
+    add_number(run, "drawCalls", json_get(json_get(&root, "drawCalls"), "avg"));
+    add_number(run, "triangles", json_get(json_get(&root, "triangles"), "avg"));
+    add_number(run, "stateChanges", json_get(json_get(&root, "stateChanges"), "avg"));
+    add_number(run, "peakTextureBytes", json_get(&root, "peakTextureBytes"));
+    add_number(run, "peakBufferBytes", json_get(&root, "peakBufferBytes"));
+    add_number(run, "peakRssKb", json_get(&root, "peakRssKb"));
+
+    json_free(&root);
+    return true;
+}
+
+static const Metric* find_metric(const Run* run, const char* name) {
+    for (int i = 0; i < run->metricCount; i++)
+        if (strcmp(run->metrics[i].name, name) == 0) return &run->metrics[i];
+    return NULL;
+}
+
+// ---------------------------------------------------------------------------
+// Statistics
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    const Metric* runs[MAX_RUNS];
+    int count;
+} Group;
+
+static uint32_t rngState = 12345;
+
+// xorshift32, reproducible comparisons for the same seed
+static uint32_t random_u32(void) {
+    uint32_t x = rngState;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return rngState = x;
+}
+
+// nearest rank, the same as the bench report uses. Reorders values: a
+// quickselect, the bootstrap asks for thousands of these
+static double quantile(double* values, int count, double q) {
+    int k = (int)(q * count);
+    if (k >= count) k = count - 1;
+
+    int lo = 0, hi = count - 1;
+    while (lo < hi) {
+        double pivot = values[lo + (hi - lo) / 2];
+        int i = lo, j = hi;
+        while (i <= j) {
+            while (values[i] < pivot) i++;
+            while (values[j] > pivot) j--;
+            if (i <= j) {
+                double t = values[i];
+                values[i++] = values[j];
+                values[j--] = t;
+            }
+        }
+        if (k <= j) hi = j;
+        else if (k >= i) lo = i;
+        else break;
+    }
+    return values[k];
+}
+
+static double mean(const double* values, int count) {
+    double sum = 0.0;
+    for (int i = 0; i < count; i++) sum += values[i];
+    return sum / count;
+}
+
+// q < 0 asks for the mean of per-run values instead of a frame quantile
+static double group_stat(const Group* g, double q, bool resample, double* scratch) {
+    int n = 0;
+    for (int r = 0; r < g->count; r++) {
+        const Metric* run = g->runs[resample ? (int)(random_u32() % (uint32_t)g->count) : r];
+        if (!resample) {
+            memcpy(&scratch[n], run->values, sizeof(double) * run->count);
+            n += run->count;
+            continue;
+        }
+        for (int i = 0; i < run->count; i++) scratch[n++] = run->values[random_u32() % run->count];
+    }
+    return q < 0.0 ? mean(scratch, n) : quantile(scratch, n, q);
+}
+
+typedef struct {
+    double base, candidate;
+    double delta, low, high;    // percent
+} Comparison;
+
+static Comparison compare(const Group* base, const Group* candidate, double q, int iterations) {
+    // resampled groups can be bigger than the originals, by picking the longest run repeatedly
+    int longest = 0;
+    for (int i = 0; i < base->count; i++) if (base->runs[i]->count > longest) longest = base->runs[i]->count;
+    for (int i = 0; i < candidate->count; i++)
+        if (candidate->runs[i]->count > longest) longest = candidate->runs[i]->count;
+    int maxRuns = base->count > candidate->count ? base->count : candidate->count;
+    double* scratch = malloc(sizeof(double) * longest * maxRuns);
+    double* deltas = malloc(sizeof(double) * iterations);
+
+    Comparison c;
+    c.base = group_stat(base, q, false, scratch);
+    c.candidate = group_stat(candidate, q, false, scratch);
+    c.delta = c.base != 0.0 ? (c.candidate - c.base) / c.base * 100.0 : 0.0;
+
+    int valid = 0;
+    for (int i = 0; i < iterations; i++) {
+        double b = group_stat(base, q, true, scratch);
+        double k = group_stat(candidate, q, true, scratch);
+        if (b != 0.0) deltas[valid++] = (k - b) / b * 100.0;
+    }
+    c.low = valid ? quantile(deltas, valid, 0.025) : c.delta;
+    c.high = valid ? quantile(deltas, valid, 0.975) : c.delta;
+
+    free(scratch);
+    free(deltas);
+    return c;
+}
+
+// ---------------------------------------------------------------------------
+
+static void usage(void) {
+    fprintf(stderr, "usage: benchcmp [--threshold pct] [--iterations n] [--seed n]\n"
+                    "                baseline.json... --candidate candidate.json...\n");
+}
+
+static void collect(Group* g, const Run* runs, int runCount, const char* scene, const char* metric) {
+    g->count = 0;
+    for (int i = 0; i < runCount && g->count < MAX_RUNS; i++) {
+        if (strcmp(runs[i].scene, scene) != 0) continue;
+        const Metric* m = find_metric(&runs[i], metric);
+        if (!m) continue;
+        g->runs[g->count++] = m;
+    }
+}
+
+int main(int argc, char** argv) {
+    double threshold = 3.0;
+    int iterations = 2000;
+    static Run base[MAX_RUNS], candidate[MAX_RUNS];
+    int baseCount = 0, candidateCount = 0;
+    bool inCandidate = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc) {
+            threshold = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+            iterations = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            rngState = (uint32_t)strtoul(argv[++i], NULL, 10);
+            if (!rngState) rngState = 1;
+        } else if (strcmp(argv[i], "--candidate") == 0) {
+            inCandidate = true;
+        } else if (argv[i][0] == '-') {
+            usage();
+            return 2;
+        } else {
+            Run* runs = inCandidate ? candidate : base;
+            int* count = inCandidate ? &candidateCount : &baseCount;
+            if (*count == MAX_RUNS) {
+                fprintf(stderr, "At most %d reports per side\n", MAX_RUNS);
+                return 2;
+            }
+            if (!load_run(&runs[*count], argv[i])) return 2;
+            (*count)++;
+        }
+    }
+    if (baseCount == 0 || candidateCount == 0 || iterations <= 0) {
+        usage();
+        return 2;
+    }
+
+    int regressions = 0, improvements = 0, compared = 0;
+    for (int s = 0; s < baseCount; s++) {
+        // each scene once, in the order the baseline reports list them
+        bool seen = false;
+        for (int t = 0; t < s; t++) seen |= strcmp(base[t].scene, base[s].scene) == 0;
+        if (seen) continue;
+        const char* scene = base[s].scene;
+
+        int candidateRuns = 0, baseRuns = 0;
+        for (int i = 0; i < candidateCount; i++) candidateRuns += strcmp(candidate[i].scene, scene) == 0;
+        for (int i = 0; i < baseCount; i++) baseRuns += strcmp(base[i].scene, scene) == 0;
+        if (candidateRuns == 0) {
+            printf("scene %s: no candidate reports\n\n", scene);
+            continue;
+        }
+
+        printf("scene %s: %d baseline, %d candidate runs\n", scene, baseRuns, candidateRuns);
+        if (baseRuns < 2 || candidateRuns < 2)
+            printf("  one run on a side leaves run-to-run noise out of the intervals, use 3 or more\n");
+        printf("  %-22s %-5s %12s %12s %9s  %-20s\n", "metric", "stat", "baseline", "candidate", "change", "95% interval");
+
+        for (int m = 0; m < base[s].metricCount; m++) {
+            const Metric* metric = &base[s].metrics[m];
+            Group b, c;
+            collect(&b, base, baseCount, scene, metric->name);
+            collect(&c, candidate, candidateCount, scene, metric->name);
+            if (c.count == 0) continue;
+
+            static const double frameQuantiles[] = { 0.5, 0.95 };
+            static const char* frameStats[] = { "p50", "p95" };
+            int stats = metric->perFrame ? 2 : 1;
+            for (int k = 0; k < stats; k++) {
+                double q = metric->perFrame ? frameQuantiles[k] : -1.0;
+                Comparison cmp = compare(&b, &c, q, iterations);
+
+                const char* verdict = "";
+                if (cmp.delta > threshold && cmp.low > 0.0) {
+                    verdict = "REGRESSION";
+                    regressions++;
+                } else if (cmp.delta < -threshold && cmp.high < 0.0) {
+                    verdict = "improvement";
+                    improvements++;
+                }
+                compared++;
+
+                char interval[32];
+                snprintf(interval, sizeof(interval), "[%+.1f%%, %+.1f%%]", cmp.low, cmp.high);
+                printf("  %-22s %-5s %12.4g %12.4g %+8.2f%%  %-20s %s\n", k == 0 ? metric->name : "",
+                       metric->perFrame ? frameStats[k] : "mean", cmp.base, cmp.candidate, cmp.delta,
+                       interval, verdict);
+            }
+        }
+        printf("\n");
+    }
+
+    printf("%d comparisons, %d regressions and %d improvements beyond %.1f%%\n", compared, regressions,
+           improvements, threshold);
+
+    for (int i = 0; i < baseCount; i++)
+        for (int m = 0; m < base[i].metricCount; m++) free(base[i].metrics[m].values);
+    for (int i = 0; i < candidateCount; i++)
+        for (int m = 0; m < candidate[i].metricCount; m++) free(candidate[i].metrics[m].values);
+
+    return regressions > 0 ? 1 : 0;
+}